@@ -0,0 +1,294 @@
+/*
+ * Throughput and latency benchmark for MuseAir.
+ *
+ *     cc -O2 -o bench bench.c && ./bench [--json] [--samples N] [--filter SUBSTR]
+ *
+ * Add `-DMUSEAIR_DISPATCH museair_dispatch.c` to benchmark the runtime dispatched long-input kernels.
+ *
+ * Every (function, size) case is warmed up, then timed `--samples` times. Throughput runs independent hashes,
+ * latency chains each digest into the next seed. Medians and the 10th / 90th percentiles are reported, cycles
+ * are TSC cycles on x86 and are omitted elsewhere.
+ */
+#define _POSIX_C_SOURCE 199309L
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <time.h>
+#if defined(__x86_64__) || defined(__i386__)
+    #include <x86intrin.h>
+    #define BENCH_HAS_CYCLES 1
+#else
+    #define BENCH_HAS_CYCLES 0
+#endif
+
+#include "museair.h"
+
+#define BENCH_MAX_SAMPLES 1001
+#define BENCH_SAMPLE_NS 2e6  // aimed duration of one sample.
+
+static volatile uint64_t bench_sink;
+
+typedef struct {
+    double ns;
+    double cycles;
+} bench_clock_t;
+
+static bench_clock_t bench_now(void) {
+    struct timespec ts;
+    bench_clock_t c;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    c.ns = (double)ts.tv_sec * 1e9 + (double)ts.tv_nsec;
+#if BENCH_HAS_CYCLES
+    c.cycles = (double)__rdtsc();
+#else
+    c.cycles = 0;
+#endif
+    return c;
+}
+
+/*----------------------------------------------------------------------------*/
+
+// One timed loop, `latency` chains each digest into the seed of the next call. Returns a checksum to keep the
+// calls alive. Defined per function by `BENCH_DEFINE` so that the hash stays inlined in the loop.
+typedef uint64_t (*bench_loop_t)(const uint8_t* in, size_t len, uint64_t iters, int latency);
+
+#define BENCH_DEFINE(NAME, EXPR)                                                                  \
+    static NEVER_INLINE uint64_t bench_loop_##NAME(const uint8_t* in, size_t len, uint64_t iters, \
+                                                   int latency) {                                 \
+        uint64_t acc = 0, seed = 0, hi = 0, k64[2];                                               \
+        uint32_t k32;                                                                             \
+        (void)in, (void)len, (void)hi, (void)k64, (void)k32;                                      \
+        if (latency) {                                                                            \
+            for (uint64_t n = 0; n < iters; n++)                                                  \
+                seed = (EXPR);                                                                    \
+            return seed;                                                                          \
+        }                                                                                         \
+        for (uint64_t n = 0; n < iters; n++) {                                                    \
+            seed = n;                                                                             \
+            acc += (EXPR);                                                                        \
+        }                                                                                         \
+        return acc;                                                                               \
+    }
+
+BENCH_DEFINE(hash, museair_hash(in, len, seed))
+BENCH_DEFINE(hash_128, museair_hash_128(in, len, seed, &hi) ^ hi)
+BENCH_DEFINE(bfast_hash, museair_bfast_hash(in, len, seed))
+BENCH_DEFINE(bfast_hash_128, museair_bfast_hash_128(in, len, seed, &hi) ^ hi)
+
+// Integer keys derived from the seed, typed entry points against the generic one with a run-time length.
+BENCH_DEFINE(hash_u32, museair_hash_u32((uint32_t)seed, seed))
+BENCH_DEFINE(hash_u64, museair_hash_u64(seed, seed))
+BENCH_DEFINE(hash_u128, museair_hash_u128(seed, ~seed, seed))
+BENCH_DEFINE(hash_k32, (k32 = (uint32_t)seed, museair_hash(&k32, len, seed)))
+BENCH_DEFINE(hash_k64, (k64[0] = seed, museair_hash(&k64[0], len, seed)))
+BENCH_DEFINE(hash_k128, (k64[0] = seed, k64[1] = ~seed, museair_hash(&k64[0], len, seed)))
+
+typedef struct {
+    const char* name;
+    bench_loop_t loop;
+    size_t fixed_len;  // only run at this size if not 0.
+} bench_func_t;
+
+static const bench_func_t BENCH_FUNCS[] = {
+    {"museair_hash", bench_loop_hash, 0},
+    {"museair_hash_128", bench_loop_hash_128, 0},
+    {"museair_bfast_hash", bench_loop_bfast_hash, 0},
+    {"museair_bfast_hash_128", bench_loop_bfast_hash_128, 0},
+    {"museair_hash_u32", bench_loop_hash_u32, 4},
+    {"museair_hash(u32)", bench_loop_hash_k32, 4},
+    {"museair_hash_u64", bench_loop_hash_u64, 8},
+    {"museair_hash(u64)", bench_loop_hash_k64, 8},
+    {"museair_hash_u128", bench_loop_hash_u128, 16},
+    {"museair_hash(u128)", bench_loop_hash_k128, 16},
+};
+
+// Sizes grouped by the branch of `_museair_tower_loong` they end in.
+typedef struct {
+    size_t len;
+    const char* path;
+} bench_size_t;
+
+static const bench_size_t BENCH_SIZES[] = {
+    {0, "short"},
+    {3, "short"},
+    {8, "short"},
+    {16, "short"},
+    {17, "layer_0"},
+    {23, "layer_0"},
+    {24, "layer_3"},
+    {47, "layer_3"},
+    {48, "layer_6"},
+    {71, "layer_6"},
+    {72, "layer_6+3"},
+    {95, "layer_6+3"},
+    {96, "layer_12"},
+    {256, "layer_12"},
+    {1024, "layer_12"},
+    {4096, "layer_12"},
+    {(size_t)4 << 20, "layer_12"},
+    {(size_t)64 << 20, "layer_12"},
+};
+
+/*----------------------------------------------------------------------------*/
+
+typedef struct {
+    double p10, p50, p90;
+} bench_stats_t;
+
+static int bench_cmp_double(const void* a, const void* b) {
+    double x = *(const double*)a, y = *(const double*)b;
+    return (x > y) - (x < y);
+}
+
+static bench_stats_t bench_stats(double* v, int n) {
+    bench_stats_t s;
+    qsort(v, (size_t)n, sizeof(double), bench_cmp_double);
+    s.p10 = v[n * 10 / 100];
+    s.p50 = v[n / 2];
+    s.p90 = v[(n - 1) * 90 / 100];
+    return s;
+}
+
+typedef struct {
+    bench_stats_t gbps;            // throughput, bytes per nanosecond.
+    bench_stats_t thru_cycles;     // cycles per hash, independent calls.
+    bench_stats_t lat_ns;          // nanoseconds per hash, dependent calls.
+    bench_stats_t lat_cycles;      // cycles per hash, dependent calls.
+} bench_result_t;
+
+// Picks an iteration count so that one sample lasts about `BENCH_SAMPLE_NS`, this doubles as the warmup.
+static uint64_t bench_calibrate(bench_loop_t loop, const uint8_t* in, size_t len) {
+    uint64_t iters = 1;
+    for (;;) {
+        bench_clock_t t0 = bench_now();
+        bench_sink += loop(in, len, iters, 0);
+        bench_clock_t t1 = bench_now();
+        double ns = t1.ns - t0.ns;
+        if (ns >= BENCH_SAMPLE_NS / 4) {
+            double want = (double)iters * BENCH_SAMPLE_NS / ns;
+            return want < 1 ? 1 : (uint64_t)want;
+        }
+        iters *= 2;
+    }
+}
+
+static bench_result_t bench_run(bench_loop_t loop, const uint8_t* in, size_t len, int samples) {
+    static double gbps[BENCH_MAX_SAMPLES], thru_cycles[BENCH_MAX_SAMPLES];
+    static double lat_ns[BENCH_MAX_SAMPLES], lat_cycles[BENCH_MAX_SAMPLES];
+    uint64_t iters = bench_calibrate(loop, in, len);
+
+    for (int s = 0; s < samples; s++) {
+        bench_clock_t t0 = bench_now();
+        bench_sink += loop(in, len, iters, 0);
+        bench_clock_t t1 = bench_now();
+        bench_sink += loop(in, len, iters, 1);
+        bench_clock_t t2 = bench_now();
+
+        gbps[s] = (double)len * (double)iters / (t1.ns - t0.ns);
+        thru_cycles[s] = (t1.cycles - t0.cycles) / (double)iters;
+        lat_ns[s] = (t2.ns - t1.ns) / (double)iters;
+        lat_cycles[s] = (t2.cycles - t1.cycles) / (double)iters;
+    }
+
+    bench_result_t r;
+    r.gbps = bench_stats(gbps, samples);
+    r.thru_cycles = bench_stats(thru_cycles, samples);
+    r.lat_ns = bench_stats(lat_ns, samples);
+    r.lat_cycles = bench_stats(lat_cycles, samples);
+    return r;
+}
+
+/*----------------------------------------------------------------------------*/
+
+static void bench_print_stats(const char* key, bench_stats_t s) {
+    printf("\"%s\": {\"p10\": %.4f, \"p50\": %.4f, \"p90\": %.4f}", key, s.p10, s.p50, s.p90);
+}
+
+static void bench_print(int json, int first, const char* func, const bench_size_t* size, bench_result_t r) {
+    if (!json) {
+        printf("%-24s %10zu %-10s %9.3f GB/s %9.1f cyc/hash %9.2f ns lat %9.1f cyc lat\n", func, size->len,
+               size->path, r.gbps.p50, r.thru_cycles.p50, r.lat_ns.p50, r.lat_cycles.p50);
+        return;
+    }
+    printf("%s\n    {\"function\": \"%s\", \"size\": %zu, \"path\": \"%s\", ", first ? "" : ",", func, size->len,
+           size->path);
+    bench_print_stats("gbps", r.gbps);
+    printf(", ");
+    bench_print_stats("ns_per_hash_latency", r.lat_ns);
+    if (BENCH_HAS_CYCLES) {
+        printf(", ");
+        bench_print_stats("cycles_per_hash", r.thru_cycles);
+        printf(", ");
+        bench_print_stats("cycles_per_hash_latency", r.lat_cycles);
+    }
+    printf("}");
+}
+
+static void usage(const char* argv0) {
+    fprintf(stderr, "usage: %s [--json] [--samples N] [--filter SUBSTR]\n", argv0);
+    exit(2);
+}
+
+int main(int argc, char** argv) {
+    int json = 0, samples = 31;
+    const char* filter = NULL;
+    for (int a = 1; a < argc; a++) {
+        if (!strcmp(argv[a], "--json")) {
+            json = 1;
+        } else if (!strcmp(argv[a], "--samples") && a + 1 < argc) {
+            samples = atoi(argv[++a]);
+            if (samples < 1 || samples > BENCH_MAX_SAMPLES)
+                usage(argv[0]);
+        } else if (!strcmp(argv[a], "--filter") && a + 1 < argc) {
+            filter = argv[++a];
+        } else {
+            usage(argv[0]);
+        }
+    }
+
+    size_t max_len = 0;
+    for (size_t s = 0; s < sizeof(BENCH_SIZES) / sizeof(BENCH_SIZES[0]); s++)
+        if (BENCH_SIZES[s].len > max_len)
+            max_len = BENCH_SIZES[s].len;
+    uint8_t* buf = (uint8_t*)malloc(max_len);
+    if (!buf) {
+        perror("malloc");
+        return 1;
+    }
+    for (size_t n = 0; n < max_len; n++)
+        buf[n] = (uint8_t)(n * 0x9E + (n >> 8));
+
+    int first = 1;
+#ifdef MUSEAIR_DISPATCH
+    const char* target = museair_dispatch_target();
+#else
+    const char* target = "inline";
+#endif
+    if (json)
+        printf("{\"algorithm_version\": \"%s\", \"kernels\": \"%s\", \"samples\": %d, \"results\": [",
+               MUSEAIR_ALGORITHM_VERSION, target, samples);
+    else
+        printf("# kernels: %s\n", target);
+    for (size_t f = 0; f < sizeof(BENCH_FUNCS) / sizeof(BENCH_FUNCS[0]); f++) {
+        if (filter && !strstr(BENCH_FUNCS[f].name, filter))
+            continue;
+        if (BENCH_FUNCS[f].fixed_len) {
+            bench_size_t size = {BENCH_FUNCS[f].fixed_len, "fixed"};
+            bench_result_t r = bench_run(BENCH_FUNCS[f].loop, buf, size.len, samples);
+            bench_print(json, first, BENCH_FUNCS[f].name, &size, r);
+            first = 0;
+            continue;
+        }
+        for (size_t s = 0; s < sizeof(BENCH_SIZES) / sizeof(BENCH_SIZES[0]); s++) {
+            bench_result_t r = bench_run(BENCH_FUNCS[f].loop, buf, BENCH_SIZES[s].len, samples);
+            bench_print(json, first, BENCH_FUNCS[f].name, &BENCH_SIZES[s], r);
+            first = 0;
+        }
+    }
+    if (json)
+        printf("\n]}\n");
+
+    free(buf);
+    return 0;
+}
@@ -0,0 +1,163 @@
+/*
+ * Filter benchmark: build time and query latency of the Bloom, cuckoo and binary fuse filters.
+ *
+ *     cc -O2 -pthread -o bench_filter bench_filter.c -lm && ./bench_filter [N] [THREADS]
+ *
+ * Builds each filter of `N` (default 10000000) distinct 16-byte keys, the fuse filter on 1 to `THREADS` (default one
+ * per online CPU) threads, then times queries of `N` keys, half of them present, one by one and batched. One by one
+ * queries hash each key before probing, so a query latency includes its cache misses. Times are the best of 3 runs,
+ * false positive rates are measured on `N` absent keys.
+ */
+#define _POSIX_C_SOURCE 199309L
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "museair_bloom.h"
+#include "museair_cuckoo.h"
+#include "museair_fuse.h"
+
+static volatile size_t bench_sink;
+
+static double bench_now(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec * 1e-9;
+}
+
+static void bench_report(const char* name, double bits, double build, double one, double batch, size_t fp, size_t n) {
+    printf("%-14s %10.2f %12.1f %12.1f %12.1f %10.4f%%\n", name, bits, build * 1e9 / (double)n, one * 1e9 / (double)n,
+           batch * 1e9 / (double)n, 100.0 * (double)fp / (double)n);
+}
+
+int main(int argc, char** argv) {
+    size_t n = argc > 1 ? strtoull(argv[1], NULL, 0) : 10000000;
+    int threads = argc > 2 ? atoi(argv[2]) : (int)sysconf(_SC_NPROCESSORS_ONLN);
+    uint8_t* bytes = (uint8_t*)malloc(n * 32);
+    const void** keys = (const void**)malloc(n * sizeof(void*));
+    const void** probes = (const void**)malloc(n * sizeof(void*));
+    size_t* lens = (size_t*)malloc(n * sizeof(size_t));
+    bool* out = (bool*)malloc(n);
+    for (size_t i = 0; i < 2 * n; i++) {
+        uint64_t k[2] = {i, i * 0x9E3779B97F4A7C15};
+        memcpy(bytes + i * 16, k, 16);
+    }
+    for (size_t i = 0; i < n; i++) {
+        keys[i] = bytes + i * 16;
+        lens[i] = 16;
+        // Half present, scattered so that probes miss the cache.
+        size_t j = (size_t)(museair_hash_u64(i, 1) % n);
+        probes[i] = i % 2 ? bytes + j * 16 : bytes + (n + j) * 16;
+    }
+
+    printf("%-14s %10s %12s %12s %12s %11s\n", "", "bits/key", "build ns/key", "query ns", "batch ns", "fpr");
+    double build, one, batch, t;
+    size_t fp;
+
+    museair_bloom_t bloom;
+    build = one = batch = 1e300;
+    for (int run = 0; run < 3; run++) {
+        t = bench_now();
+        museair_bloom_init(&bloom, museair_bloom_blocks_for(n, 16), 0);
+        museair_bloom_insert_batch(&bloom, keys, lens, n);
+        t = bench_now() - t;
+        build = t < build ? t : build;
+        t = bench_now();
+        size_t hits = 0;
+        for (size_t i = 0; i < n; i++) {
+            hits += museair_bloom_query(&bloom, probes[i], 16);
+        }
+        t = bench_now() - t;
+        one = t < one ? t : one;
+        t = bench_now();
+        museair_bloom_query_batch(&bloom, probes, lens, n, out);
+        t = bench_now() - t;
+        batch = t < batch ? t : batch;
+        bench_sink = hits + out[0];
+        if (run < 2) {
+            museair_bloom_free(&bloom);
+        }
+    }
+    fp = 0;
+    for (size_t i = 0; i < n; i++) {
+        fp += museair_bloom_query(&bloom, bytes + (n + i) * 16, 16);
+    }
+    bench_report("bloom", (double)bloom.nblocks * 512 / (double)n, build, one, batch, fp, n);
+    museair_bloom_free(&bloom);
+
+    museair_cuckoo_t cuckoo;
+    build = one = batch = 1e300;
+    for (int run = 0; run < 3; run++) {
+        t = bench_now();
+        museair_cuckoo_init(&cuckoo, museair_cuckoo_buckets_for(n), 0);
+        bench_sink = museair_cuckoo_insert_batch(&cuckoo, keys, lens, n);
+        t = bench_now() - t;
+        build = t < build ? t : build;
+        t = bench_now();
+        size_t hits = 0;
+        for (size_t i = 0; i < n; i++) {
+            hits += museair_cuckoo_contains(&cuckoo, probes[i], 16);
+        }
+        t = bench_now() - t;
+        one = t < one ? t : one;
+        t = bench_now();
+        museair_cuckoo_contains_batch(&cuckoo, probes, lens, n, out);
+        t = bench_now() - t;
+        batch = t < batch ? t : batch;
+        bench_sink = hits + out[0];
+        if (run < 2) {
+            museair_cuckoo_free(&cuckoo);
+        }
+    }
+    fp = 0;
+    for (size_t i = 0; i < n; i++) {
+        fp += museair_cuckoo_contains(&cuckoo, bytes + (n + i) * 16, 16);
+    }
+    bench_report("cuckoo", (double)cuckoo.nbuckets * 64 / (double)n, build, one, batch, fp, n);
+    museair_cuckoo_free(&cuckoo);
+
+    museair_fuse_t fuse;
+    for (int th = 1; th <= threads; th *= 2) {
+        build = one = batch = 1e300;
+        for (int run = 0; run < 3; run++) {
+            t = bench_now();
+            if (!museair_fuse_build(&fuse, keys, lens, n, 0, th)) {
+                printf("fuse build failed\n");
+                return 1;
+            }
+            t = bench_now() - t;
+            build = t < build ? t : build;
+            t = bench_now();
+            size_t hits = 0;
+            for (size_t i = 0; i < n; i++) {
+                hits += museair_fuse_contains(&fuse, probes[i], 16);
+            }
+            t = bench_now() - t;
+            one = t < one ? t : one;
+            t = bench_now();
+            museair_fuse_contains_batch(&fuse, probes, lens, n, out);
+            t = bench_now() - t;
+            batch = t < batch ? t : batch;
+            bench_sink = hits + out[0];
+            if (run < 2) {
+                museair_fuse_free(&fuse);
+            }
+        }
+        fp = 0;
+        for (size_t i = 0; i < n; i++) {
+            fp += museair_fuse_contains(&fuse, bytes + (n + i) * 16, 16);
+        }
+        char name[32];
+        snprintf(name, sizeof(name), "fuse %d thr", th);
+        bench_report(name, (double)fuse.array_length * 8 / (double)n, build, one, batch, fp, n);
+        museair_fuse_free(&fuse);
+    }
+    free(out);
+    free(lens);
+    free(probes);
+    free(keys);
+    free(bytes);
+}
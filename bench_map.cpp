@@ -0,0 +1,193 @@
+/*
+ * Hash map benchmark: museair::flat_map against std::unordered_map, on string and integer keys, then the scaling
+ * of museair::concurrent_digest_map against mutex-sharded std::unordered_maps.
+ *
+ *     c++ -O2 -std=c++17 -pthread -o bench_map bench_map.cpp && ./bench_map [N] [THREADS]
+ *
+ * Each map gets the same `N` (default 1000000) random keys. Inserts start from an empty map, finds are half hits
+ * in insertion order and half misses, erases remove every key. Times are nanoseconds per operation, best of 5.
+ *
+ * The concurrent maps deduplicate 2N keys, every key twice, split between 1, 2, 4, ... up to `THREADS` (default
+ * all hardware threads) threads. Rates are millions of inserts per second, best of 5.
+ */
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <mutex>
+#include <random>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include "museair_concurrent_map.hpp"
+#include "museair_flat_map.hpp"
+
+static volatile std::uint64_t sink;
+
+template <typename F>
+static double time_ns(std::size_t ops, F&& f) {
+    auto t0 = std::chrono::steady_clock::now();
+    f();
+    std::chrono::duration<double, std::nano> d = std::chrono::steady_clock::now() - t0;
+    return d.count() / static_cast<double>(ops);
+}
+
+template <typename F>
+static double best_ns(std::size_t ops, F&& f) {
+    double best = 1e300;
+    for (int run = 0; run < 5; run++) {
+        best = std::min(best, time_ns(ops, f));
+    }
+    return best;
+}
+
+// `keys` are inserted, `misses` are absent.
+template <typename Map, typename K>
+static void bench(const char* name, const std::vector<K>& keys, const std::vector<K>& misses) {
+    const std::size_t n = keys.size();
+    double insert = best_ns(n, [&] {
+        Map m;
+        for (std::size_t i = 0; i < n; i++) {
+            m[keys[i]] = i;
+        }
+        sink = m.size();
+    });
+
+    Map m;
+    for (std::size_t i = 0; i < n; i++) {
+        m[keys[i]] = i;
+    }
+    double hit = best_ns(n, [&] {
+        std::uint64_t acc = 0;
+        for (const K& k : keys) {
+            acc += m.find(k)->second;
+        }
+        sink = acc;
+    });
+    double miss = best_ns(n, [&] {
+        std::uint64_t acc = 0;
+        for (const K& k : misses) {
+            acc += m.find(k) == m.end();
+        }
+        sink = acc;
+    });
+    double erase = 1e300;
+    for (int run = 0; run < 5; run++) {
+        Map e = m;  // not timed.
+        erase = std::min(erase, time_ns(n, [&] {
+                             for (const K& k : keys) {
+                                 e.erase(k);
+                             }
+                             sink = e.size();
+                         }));
+    }
+    printf("%-44s %10.1f %10.1f %10.1f %10.1f\n", name, insert, hit, miss, erase);
+}
+
+// What concurrent_digest_map replaces: a lock per shard, held for lookups too.
+class locked_map {
+   public:
+    bool insert(std::uint64_t key, std::uint64_t value) {
+        shard& s = shards_[museair::hasher{}(key) >> 58];
+        std::lock_guard<std::mutex> guard(s.lock);
+        return s.map.emplace(key, value).second;
+    }
+
+   private:
+    struct alignas(64) shard {
+        std::mutex lock;
+        std::unordered_map<std::uint64_t, std::uint64_t, museair::hasher> map;
+    };
+    shard shards_[64];
+};
+
+template <typename Map, typename Insert>
+static double scaling_mops(const std::vector<std::uint64_t>& keys, unsigned threads, Insert insert) {
+    double best = 1e300;
+    for (int run = 0; run < 5; run++) {
+        Map m;
+        best = std::min(best, time_ns(keys.size(), [&] {
+                            std::vector<std::thread> workers;
+                            for (unsigned t = 0; t < threads; t++) {
+                                workers.emplace_back([&, t] {
+                                    std::size_t inserted = 0;
+                                    for (std::size_t i = t; i < keys.size(); i += threads) {
+                                        inserted += insert(m, keys[i], i);
+                                    }
+                                    sink = inserted;
+                                });
+                            }
+                            for (auto& w : workers) {
+                                w.join();
+                            }
+                        }));
+    }
+    return 1e3 / best;
+}
+
+static void bench_scaling(const std::vector<std::uint64_t>& ints, unsigned max_threads) {
+    std::vector<std::uint64_t> keys(ints);
+    keys.insert(keys.end(), ints.begin(), ints.end());
+    std::shuffle(keys.begin(), keys.end(), std::mt19937_64(7));
+
+    std::string title = std::to_string(keys.size()) + " inserts, 50% duplicates, Mops/s";
+    printf("\n%-44s %10s %10s\n", title.c_str(), "digest", "locked");
+    for (unsigned threads = 1;; threads = std::min(2 * threads, max_threads)) {
+        double digest = scaling_mops<museair::concurrent_digest_map>(
+            keys, threads,
+            [](museair::concurrent_digest_map& m, std::uint64_t k, std::uint64_t v) {
+                return m.insert(&k, sizeof(k), v).second;
+            });
+        double locked = scaling_mops<locked_map>(
+            keys, threads, [](locked_map& m, std::uint64_t k, std::uint64_t v) { return m.insert(k, v); });
+        std::string name = std::to_string(threads) + (threads == 1 ? " thread" : " threads");
+        printf("%-44s %10.1f %10.1f\n", name.c_str(), digest, locked);
+        if (threads == max_threads) {
+            break;
+        }
+    }
+}
+
+int main(int argc, char** argv) {
+    std::size_t n = argc > 1 ? std::strtoull(argv[1], nullptr, 0) : 1000000;
+    unsigned max_threads = argc > 2 ? static_cast<unsigned>(std::strtoul(argv[2], nullptr, 0))
+                                    : std::max(1u, std::thread::hardware_concurrency());
+    std::mt19937_64 rng(42);
+
+    std::vector<std::uint64_t> ints(n), int_misses(n);
+    for (std::size_t i = 0; i < n; i++) {
+        ints[i] = rng() | 1;
+        int_misses[i] = rng() & ~UINT64_C(1);
+    }
+    std::vector<std::string> strs(n), str_misses(n);
+    auto random_string = [&](char first) {
+        std::string s(8 + rng() % 17, ' ');
+        s[0] = first;
+        for (std::size_t i = 1; i < s.size(); i++) {
+            s[i] = static_cast<char>('a' + rng() % 26);
+        }
+        return s;
+    };
+    for (std::size_t i = 0; i < n; i++) {
+        strs[i] = random_string('k');
+        str_misses[i] = random_string('m');
+    }
+
+    using u64 = std::uint64_t;
+    std::string title = std::to_string(n) + " keys, ns/op";
+    printf("%-44s %10s %10s %10s %10s\n", title.c_str(), "insert", "find hit", "find miss", "erase");
+    bench<museair::flat_map<u64, u64>>("u64    museair::flat_map", ints, int_misses);
+    bench<std::unordered_map<u64, u64, museair::hasher>>("u64    std::unordered_map, museair::hasher", ints,
+                                                         int_misses);
+    bench<std::unordered_map<u64, u64>>("u64    std::unordered_map, std::hash", ints, int_misses);
+    bench<museair::flat_map<std::string, u64>>("string museair::flat_map", strs, str_misses);
+    bench<std::unordered_map<std::string, u64, museair::hasher>>("string std::unordered_map, museair::hasher", strs,
+                                                                 str_misses);
+    bench<std::unordered_map<std::string, u64>>("string std::unordered_map, std::hash", strs, str_misses);
+
+    bench_scaling(ints, std::max(1u, max_threads));
+}
@@ -0,0 +1,82 @@
+/*
+ * Minimal perfect hash benchmark: build time, size and lookup latency.
+ *
+ *     cc -O2 -pthread -o bench_mphf bench_mphf.c && ./bench_mphf [N] [THREADS]
+ *
+ * Builds a function of `N` (default 10000000) distinct 16-byte keys on 1 to `THREADS` (default one per online CPU)
+ * threads, then looks the keys up in a scattered order, so that a lookup latency includes its cache misses, and in
+ * key order. Times are the best of 3 runs.
+ */
+#define _POSIX_C_SOURCE 199309L
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "museair_mphf.h"
+
+static volatile uint64_t bench_sink;
+
+static double bench_now(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec * 1e-9;
+}
+
+int main(int argc, char** argv) {
+    size_t n = argc > 1 ? strtoull(argv[1], NULL, 0) : 10000000;
+    int threads = argc > 2 ? atoi(argv[2]) : (int)sysconf(_SC_NPROCESSORS_ONLN);
+    uint8_t* bytes = (uint8_t*)malloc(n * 16);
+    const void** keys = (const void**)malloc(n * sizeof(void*));
+    const void** probes = (const void**)malloc(n * sizeof(void*));
+    size_t* lens = (size_t*)malloc(n * sizeof(size_t));
+    for (size_t i = 0; i < n; i++) {
+        uint64_t k[2] = {i, i * 0x9E3779B97F4A7C15};
+        memcpy(bytes + i * 16, k, 16);
+        keys[i] = bytes + i * 16;
+        lens[i] = 16;
+        probes[i] = bytes + (size_t)(museair_hash_u64(i, 1) % n) * 16;
+    }
+
+    printf("%-10s %12s %10s %12s %12s\n", "threads", "build ns/key", "bits/key", "lookup ns", "in order ns");
+    museair_mphf_t f;
+    for (int th = 1; th <= threads; th *= 2) {
+        double build = 1e300, scattered = 1e300, ordered = 1e300;
+        for (int run = 0; run < 3; run++) {
+            double t = bench_now();
+            if (!museair_mphf_build(&f, keys, lens, n, 0, th)) {
+                printf("build failed\n");
+                return 1;
+            }
+            t = bench_now() - t;
+            build = t < build ? t : build;
+            uint64_t sum = 0;
+            t = bench_now();
+            for (size_t i = 0; i < n; i++) {
+                sum += museair_mphf_lookup(&f, probes[i], 16);
+            }
+            t = bench_now() - t;
+            scattered = t < scattered ? t : scattered;
+            t = bench_now();
+            for (size_t i = 0; i < n; i++) {
+                sum += museair_mphf_lookup(&f, keys[i], 16);
+            }
+            t = bench_now() - t;
+            ordered = t < ordered ? t : ordered;
+            bench_sink = sum;
+            if (run < 2) {
+                museair_mphf_free(&f);
+            }
+        }
+        printf("%-10d %12.1f %10.3f %12.1f %12.1f\n", th, build * 1e9 / (double)n,
+               (double)museair_mphf_image_size(&f) * 8 / (double)n, scattered * 1e9 / (double)n,
+               ordered * 1e9 / (double)n);
+        museair_mphf_free(&f);
+    }
+    free(lens);
+    free(probes);
+    free(keys);
+    free(bytes);
+}
@@ -0,0 +1,130 @@
+/*
+ * Sketch benchmark: HyperLogLog adds and merges, Count-Min updates.
+ *
+ *     cc -O2 -o bench_sketch bench_sketch.c -lm && ./bench_sketch [N]
+ *
+ * HyperLogLog adds insert `N` (default 10000000) distinct digests or 16-byte keys into a fresh sketch of each
+ * precision, merges combine two dense sketches. Count-Min updates stream `N` keys drawn from `N / 10` distinct ones
+ * into depth 4 sketches tracking the top 100, one by one and batched. Rates are the best of 5 runs.
+ */
+#define _POSIX_C_SOURCE 199309L
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <time.h>
+
+#include "museair_cms.h"
+#include "museair_hll.h"
+
+static volatile double bench_sink;
+
+static double bench_now(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec * 1e-9;
+}
+
+static void bench_hll(int p, const uint64_t* hashes, const void* const* keys, const size_t* lens, size_t n) {
+    double add = 1e300, batch = 1e300, merge = 1e300;
+    museair_hll_t h, other;
+    for (int run = 0; run < 5; run++) {
+        museair_hll_init(&h, p, 0);
+        double t = bench_now();
+        museair_hll_add_hashes(&h, hashes, n);
+        t = bench_now() - t;
+        add = t < add ? t : add;
+        bench_sink = museair_hll_estimate(&h);
+        museair_hll_free(&h);
+
+        museair_hll_init(&h, p, 0);
+        t = bench_now();
+        museair_hll_add_batch(&h, keys, lens, n);
+        t = bench_now() - t;
+        batch = t < batch ? t : batch;
+        bench_sink = museair_hll_estimate(&h);
+        museair_hll_free(&h);
+    }
+
+    museair_hll_init(&h, p, 0);
+    museair_hll_init(&other, p, 0);
+    museair_hll_add_hashes(&h, hashes, n / 2);
+    museair_hll_add_hashes(&other, hashes + n / 2, n - n / 2);
+    const int merges = (int)(((size_t)1 << 28) >> p);
+    for (int run = 0; run < 5; run++) {
+        double t = bench_now();
+        for (int i = 0; i < merges; i++) {
+            museair_hll_merge(&h, &other);
+        }
+        t = bench_now() - t;
+        merge = t < merge ? t : merge;
+    }
+    bench_sink = museair_hll_estimate(&h);
+    printf("hll p=%-2d %14.1f %14.1f %14.2f %14.2f\n", p, n / add * 1e-6, n / batch * 1e-6, merges / merge * 1e-6,
+           (double)merges * (double)((size_t)1 << p) / merge * 1e-9);
+    museair_hll_free(&h);
+    museair_hll_free(&other);
+}
+
+static void bench_cms(uint64_t width, int bits, bool conservative, const void* const* keys, const size_t* lens,
+                      size_t n) {
+    double add = 1e300, batch = 1e300;
+    museair_cms_t s;
+    for (int run = 0; run < 5; run++) {
+        museair_cms_init(&s, width, 4, bits, conservative, 100, 0);
+        double t = bench_now();
+        for (size_t i = 0; i < n; i++) {
+            museair_cms_add(&s, keys[i], lens[i], 1);
+        }
+        t = bench_now() - t;
+        add = t < add ? t : add;
+        museair_cms_free(&s);
+
+        museair_cms_init(&s, width, 4, bits, conservative, 100, 0);
+        t = bench_now();
+        museair_cms_add_batch(&s, keys, lens, NULL, n);
+        t = bench_now() - t;
+        batch = t < batch ? t : batch;
+        bench_sink = (double)s.top_len;
+        museair_cms_free(&s);
+    }
+    printf("cms %-4s %3d-bit x %-8llu %12.1f %12.1f\n", conservative ? "cu" : "", bits, (unsigned long long)width,
+           n / add * 1e-6, n / batch * 1e-6);
+}
+
+int main(int argc, char** argv) {
+    size_t n = argc > 1 ? strtoull(argv[1], NULL, 0) : 10000000;
+    uint64_t* hashes = (uint64_t*)malloc(n * sizeof(uint64_t));
+    uint8_t* bytes = (uint8_t*)malloc(n * 16);
+    const void** keys = (const void**)malloc(n * sizeof(void*));
+    size_t* lens = (size_t*)malloc(n * sizeof(size_t));
+    for (size_t i = 0; i < n; i++) {
+        uint64_t k[2] = {i, i * 0x9E3779B97F4A7C15};
+        hashes[i] = museair_hash_u64(i, 0);
+        memcpy(bytes + i * 16, k, 16);
+        keys[i] = bytes + i * 16;
+        lens[i] = 16;
+    }
+
+    printf("%-8s %14s %14s %14s %14s\n", "", "add Mdigest/s", "batch Mkey/s", "merge M/s", "merge GB/s");
+    for (int p = 10; p <= 18; p += 4) {
+        bench_hll(p, hashes, keys, lens, n);
+    }
+
+    // Skewed: a third of the stream hits 1% of the keys.
+    for (size_t i = 0; i < n; i++) {
+        size_t key = (size_t)(hashes[i] >> 2) % (hashes[i] % 3 ? n / 10 + 1 : n / 1000 + 1);
+        keys[i] = bytes + key * 16;
+    }
+    printf("\n%-27s %12s %12s\n", "", "add Mkey/s", "batch Mkey/s");
+    for (uint64_t width = 1 << 14; width <= (1 << 22); width <<= 8) {
+        for (int bits = 8; bits <= 32; bits *= 2) {
+            bench_cms(width, bits, false, keys, lens, n);
+        }
+        bench_cms(width, 32, true, keys, lens, n);
+    }
+    free(lens);
+    free(keys);
+    free(bytes);
+    free(hashes);
+}
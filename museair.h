@@ -37,6 +37,9 @@
  * SOFTWARE.
  */
 
+#ifndef MUSEAIR_H
+#define MUSEAIR_H
+
 #include <stddef.h>
 #include <stdint.h>
 #include <string.h>
@@ -44,6 +47,15 @@
     #include <intrin.h>
     #pragma intrinsic(_umul128)
 #endif
+#if defined(__SSE2__) || defined(_M_X64)
+    #include <emmintrin.h>
+#endif
+#if defined(__unix__) || defined(__APPLE__)
+    #include <sys/uio.h>
+    #define MUSEAIR_HAS_IOVEC 1
+#else
+    #define MUSEAIR_HAS_IOVEC 0
+#endif
 
 #define MUSEAIR_ALGORITHM_VERSION "0.2"
 
@@ -84,6 +96,15 @@ typedef uint8_t bool;
     #define _museair_unlikely(x) (x)
 #endif
 
+// Fetches the cache line at `p` ahead of a read (`rw` 0) or a write (1).
+#if defined(__GNUC__) || defined(__INTEL_COMPILER) || defined(__clang__)
+    #define _museair_prefetch(p, rw) __builtin_prefetch(p, rw)
+#elif defined(__SSE2__) || defined(_M_X64)
+    #define _museair_prefetch(p, rw) _mm_prefetch((const char*)(p), _MM_HINT_T0)
+#else
+    #define _museair_prefetch(p, rw) ((void)(p))
+#endif
+
 /*----------------------------------------------------------------------------*/
 
 static FORCE_INLINE uint64_t _museair_bswap_64(uint64_t v) {
@@ -348,6 +369,51 @@ static FORCE_INLINE void _museair_layer_f(const bool BFast, size_t len, uint64_t
 
 /*----------------------------------------------------------------------------*/
 
+static FORCE_INLINE void _museair_tower_init(uint64_t* state, const uint64_t seed) {
+    state[0] = MUSEAIR_SECRET[0] + seed;
+    state[1] = MUSEAIR_SECRET[1] - seed;
+    state[2] = MUSEAIR_SECRET[2] ^ seed;
+    state[3] = MUSEAIR_SECRET[3];
+    state[4] = MUSEAIR_SECRET[4];
+    state[5] = MUSEAIR_SECRET[5];
+}
+
+static FORCE_INLINE void _museair_tower_layer_12_enter(uint64_t* state, const uint64_t seed, uint64_t* ring_prev) {
+    state[3] += seed;
+    state[4] -= seed;
+    state[5] ^= seed;
+    *ring_prev = MUSEAIR_RING_PREV;
+}
+
+static FORCE_INLINE void _museair_tower_layer_12_leave(uint64_t* state, const uint64_t ring_prev) {
+    state[0] ^= ring_prev;
+}
+
+// Everything after the `layer_12` loop, `p` points to the last `q < 96` bytes of the whole `len` bytes input.
+static FORCE_INLINE void _museair_tower_tail(const bool BFast,
+                                             uint64_t* state,
+                                             const uint8_t* p,
+                                             size_t q,
+                                             const size_t len,
+                                             uint64_t* i,
+                                             uint64_t* j,
+                                             uint64_t* k) {
+    if (q >= 8 * 6) {
+        _museair_layer_6(BFast, &state[0], p);
+        p += 8 * 6;
+        q -= 8 * 6;
+    }
+
+    if (q >= 8 * 3) {
+        _museair_layer_3(BFast, &state[0], p);
+        p += 8 * 3;
+        q -= 8 * 3;
+    }
+
+    _museair_layer_0(&state[0], p, q, len, i, j, k);
+    _museair_layer_f(BFast, len, i, j, k);
+}
+
 static FORCE_INLINE void _museair_tower_loong(const bool BFast,
                                               const uint8_t* bytes,
                                               const size_t len,
@@ -358,36 +424,21 @@ static FORCE_INLINE void _museair_tower_loong(const bool BFast,
     const uint8_t* p = bytes;
     size_t q = len;
 
-    uint64_t state[6] = {MUSEAIR_SECRET[0] + seed, MUSEAIR_SECRET[1] - seed, MUSEAIR_SECRET[2] ^ seed,
-                         MUSEAIR_SECRET[3],        MUSEAIR_SECRET[4],        MUSEAIR_SECRET[5]};
+    uint64_t state[6];
+    _museair_tower_init(&state[0], seed);
 
     if (q >= 8 * 12) {
-        state[3] += seed;
-        state[4] -= seed;
-        state[5] ^= seed;
-        uint64_t ring_prev = MUSEAIR_RING_PREV;
+        uint64_t ring_prev;
+        _museair_tower_layer_12_enter(&state[0], seed, &ring_prev);
         do {
             _museair_layer_12(BFast, &state[0], p, &ring_prev);
             p += 8 * 12;
             q -= 8 * 12;
         } while (_museair_likely(q >= 8 * 12));
-        state[0] ^= ring_prev;
-    }
-
-    if (q >= 8 * 6) {
-        _museair_layer_6(BFast, &state[0], p);
-        p += 8 * 6;
-        q -= 8 * 6;
+        _museair_tower_layer_12_leave(&state[0], ring_prev);
     }
 
-    if (q >= 8 * 3) {
-        _museair_layer_3(BFast, &state[0], p);
-        p += 8 * 3;
-        q -= 8 * 3;
-    }
-
-    _museair_layer_0(&state[0], p, q, len, i, j, k);
-    _museair_layer_f(BFast, len, i, j, k);
+    _museair_tower_tail(BFast, &state[0], p, q, len, i, j, k);
 }
 
 static FORCE_INLINE void _museair_tower_short(const uint8_t* bytes,
@@ -496,6 +547,7 @@ static FORCE_INLINE void _museair_hash_short_128(const bool BFast,
     _museair_epi_short_128(BFast, i, j);
 }
 
+#ifndef MUSEAIR_DISPATCH
 static NEVER_INLINE void _museair_hash_loong(const bool BFast,
                                              const uint8_t* bytes,
                                              const size_t len,
@@ -516,15 +568,38 @@ static NEVER_INLINE void _museair_hash_loong_128(const bool BFast,
     _museair_tower_loong(BFast, bytes, len, seed, i, j, k);
     _museair_epi_loong_128(BFast, i, j, k);
 }
+#endif
 
 /*----------------------------------------------------------------------------*/
 
+#ifdef MUSEAIR_DISPATCH
+    // Long-input kernels compiled for several ISA levels by "museair_dispatch.c", which must be linked in.
+    #ifdef __cplusplus
+extern "C" {
+    #endif
+void museair_dispatch_hash_loong(const uint8_t*, size_t, uint64_t, uint64_t*, uint64_t*, uint64_t*);
+void museair_dispatch_hash_loong_128(const uint8_t*, size_t, uint64_t, uint64_t*, uint64_t*, uint64_t*);
+void museair_dispatch_bfast_hash_loong(const uint8_t*, size_t, uint64_t, uint64_t*, uint64_t*, uint64_t*);
+void museair_dispatch_bfast_hash_loong_128(const uint8_t*, size_t, uint64_t, uint64_t*, uint64_t*, uint64_t*);
+const char* museair_dispatch_target(void);
+    #ifdef __cplusplus
+}
+    #endif
+    #define _museair_hash_loong_entry(BFast, ...) \
+        ((BFast) ? museair_dispatch_bfast_hash_loong : museair_dispatch_hash_loong)(__VA_ARGS__)
+    #define _museair_hash_loong_128_entry(BFast, ...) \
+        ((BFast) ? museair_dispatch_bfast_hash_loong_128 : museair_dispatch_hash_loong_128)(__VA_ARGS__)
+#else
+    #define _museair_hash_loong_entry(BFast, ...) _museair_hash_loong(BFast, __VA_ARGS__)
+    #define _museair_hash_loong_128_entry(BFast, ...) _museair_hash_loong_128(BFast, __VA_ARGS__)
+#endif
+
 static FORCE_INLINE uint64_t _museair_hash(const bool BFast, const void* in, const size_t len, const uint64_t seed) {
     uint64_t i, j, k;
     if (_museair_likely(len <= 16)) {
         _museair_hash_short((const uint8_t*)in, len, seed, &i, &j);
     } else {
-        _museair_hash_loong(BFast, (const uint8_t*)in, len, seed, &i, &j, &k);
+        _museair_hash_loong_entry(BFast, (const uint8_t*)in, len, seed, &i, &j, &k);
     }
 #if MUSEAIR_BSWAP > 0
     i = _museair_bswap_64(i);
@@ -538,7 +613,7 @@ _museair_hash_128(const bool BFast, const void* in, const size_t len, const uint
     if (_museair_likely(len <= 16)) {
         _museair_hash_short_128(BFast, (const uint8_t*)in, len, seed, &i, &j);
     } else {
-        _museair_hash_loong_128(BFast, (const uint8_t*)in, len, seed, &i, &j, &k);
+        _museair_hash_loong_128_entry(BFast, (const uint8_t*)in, len, seed, &i, &j, &k);
     }
 #if MUSEAIR_BSWAP > 0
     i = _museair_bswap_64(i);
@@ -565,3 +640,950 @@ static inline uint64_t museair_bfast_hash_128(const void* in,
                                               uint64_t* upper_half) {
     return _museair_hash_128(true, in, len, seed, upper_half);
 }
+
+/*----------------------------------------------------------------------------*/
+
+// Loads of a native integer as `_museair_read_u64` / `_museair_read_u32` would see its bytes in memory.
+static FORCE_INLINE uint64_t _museair_native_u64(uint64_t v) {
+#if MUSEAIR_BSWAP > 0
+    v = _museair_bswap_64(v);
+#endif
+    return v;
+}
+static FORCE_INLINE uint64_t _museair_native_u32(uint32_t v) {
+#if MUSEAIR_BSWAP > 0
+    v = _museair_bswap_32(v);
+#endif
+    return (uint64_t)v;
+}
+
+// Stores that `_museair_read_u64` / `_museair_read_u32` read back, little-endian on every host. The filters and
+// functions of the companion headers save to flat images written with these: a 64-byte header, an 8-byte magic then
+// little-endian fields and zeros, followed by the data, little-endian too. Their `_load` functions check an image
+// and use it in place, so it can be queried straight from a `mmap`ed file. Each header documents only its fields.
+static FORCE_INLINE void _museair_write_u64(uint8_t* p, uint64_t v) {
+    v = _museair_native_u64(v);
+    memcpy(p, &v, 8);
+}
+static FORCE_INLINE void _museair_write_u32(uint8_t* p, uint32_t v) {
+    v = (uint32_t)_museair_native_u32(v);
+    memcpy(p, &v, 4);
+}
+
+// `_museair_hash_short` with `_museair_read_short` already done for a length known at compile time.
+static FORCE_INLINE uint64_t _museair_hash_fixed(uint64_t i, uint64_t j, const size_t len, const uint64_t seed) {
+    uint64_t lo, hi;
+    _museair_wmul(&lo, &hi, seed ^ MUSEAIR_SECRET[0], len ^ MUSEAIR_SECRET[1]);
+    i ^= lo ^ len;
+    j ^= hi ^ seed;
+    _museair_epi_short(&i, &j);
+#if MUSEAIR_BSWAP > 0
+    i = _museair_bswap_64(i);
+#endif
+    return i;
+}
+
+// Same as `museair_hash(&v, sizeof(v), seed)`, without any branch or memory round-trip. Keys of at most 16 bytes
+// have the same 64-bit digest in BFast mode, so these serve `museair_bfast_hash` as well.
+static inline uint64_t museair_hash_u32(const uint32_t v, const uint64_t seed) {
+    uint64_t w = _museair_native_u32(v);
+    return _museair_hash_fixed((w << 32) | w, (w << 32) | w, 4, seed);
+}
+static inline uint64_t museair_hash_u64(const uint64_t v, const uint64_t seed) {
+    uint64_t w = _museair_native_u64(v);
+    return _museair_hash_fixed(_museair_rotl(w, 32), w, 8, seed);
+}
+// Same as `museair_hash(v, 16, seed)` with `const uint64_t v[2] = {lo, hi}`.
+static inline uint64_t museair_hash_u128(const uint64_t lo, const uint64_t hi, const uint64_t seed) {
+    uint64_t a = _museair_native_u64(lo), b = _museair_native_u64(hi);
+    return _museair_hash_fixed((a << 32) | (b >> 32), (a & UINT64_C(0xffffffff00000000)) | (b & 0xffffffff), 16, seed);
+}
+
+/*----------------------------------------------------------------------------*/
+
+// Incremental hasher, produces digests bit-identical to the one-shot functions above.
+//
+// Bytes are staged in `buffer` only until a whole 96 bytes block is available, then fed to `layer_12` directly.
+// A stream must be updated with either `museair_stream_update` or `museair_bfast_stream_update`, not both,
+// and finalized with the digest functions of the same variant.
+typedef struct {
+    uint64_t state[6];
+    uint64_t ring_prev;
+    uint64_t seed;
+    size_t len;       // total bytes absorbed so far.
+    size_t buffered;  // bytes in `buffer`, always less than 96.
+    uint8_t buffer[8 * 12];
+} museair_stream_t;
+
+static FORCE_INLINE void _museair_stream_update(const bool BFast, museair_stream_t* s, const void* in, size_t len) {
+    const uint8_t* p = (const uint8_t*)in;
+
+    if (s->buffered + len < 8 * 12) {
+        memcpy(&s->buffer[s->buffered], p, len);
+        s->buffered += len;
+        s->len += len;
+        return;
+    }
+
+    // Work on local copies, `p` may alias anything.
+    uint64_t state[6] = {s->state[0], s->state[1], s->state[2], s->state[3], s->state[4], s->state[5]};
+    uint64_t ring_prev = s->ring_prev;
+
+    if (s->len < 8 * 12) {
+        _museair_tower_layer_12_enter(&state[0], s->seed, &ring_prev);
+    }
+    s->len += len;
+
+    if (s->buffered > 0) {
+        size_t fill = 8 * 12 - s->buffered;
+        memcpy(&s->buffer[s->buffered], p, fill);
+        _museair_layer_12(BFast, &state[0], &s->buffer[0], &ring_prev);
+        p += fill;
+        len -= fill;
+    }
+
+    while (_museair_likely(len >= 8 * 12)) {
+        _museair_layer_12(BFast, &state[0], p, &ring_prev);
+        p += 8 * 12;
+        len -= 8 * 12;
+    }
+
+    memcpy(&s->buffer[0], p, len);
+    s->buffered = len;
+
+    memcpy(&s->state[0], &state[0], sizeof(state));
+    s->ring_prev = ring_prev;
+}
+
+// Returns `false` if no block has been absorbed yet, then the caller should hash `buffer` in one shot.
+static FORCE_INLINE bool _museair_stream_tower(const bool BFast,
+                                               const museair_stream_t* s,
+                                               uint64_t* i,
+                                               uint64_t* j,
+                                               uint64_t* k) {
+    if (s->len < 8 * 12) {
+        return false;
+    }
+    uint64_t state[6] = {s->state[0], s->state[1], s->state[2], s->state[3], s->state[4], s->state[5]};
+    _museair_tower_layer_12_leave(&state[0], s->ring_prev);
+    _museair_tower_tail(BFast, &state[0], &s->buffer[0], s->buffered, s->len, i, j, k);
+    return true;
+}
+
+static inline uint64_t _museair_stream_digest(const bool BFast, const museair_stream_t* s) {
+    uint64_t i, j, k;
+    if (!_museair_stream_tower(BFast, s, &i, &j, &k)) {
+        return _museair_hash(BFast, &s->buffer[0], s->len, s->seed);
+    }
+    _museair_epi_loong(BFast, &i, &j, &k);
+#if MUSEAIR_BSWAP > 0
+    i = _museair_bswap_64(i);
+#endif
+    return i;
+}
+
+static inline uint64_t _museair_stream_digest_128(const bool BFast, const museair_stream_t* s, uint64_t* upper_half) {
+    uint64_t i, j, k;
+    if (!_museair_stream_tower(BFast, s, &i, &j, &k)) {
+        return _museair_hash_128(BFast, &s->buffer[0], s->len, s->seed, upper_half);
+    }
+    _museair_epi_loong_128(BFast, &i, &j, &k);
+#if MUSEAIR_BSWAP > 0
+    i = _museair_bswap_64(i);
+    j = _museair_bswap_64(j);
+#endif
+    *upper_half = j;
+    return i;
+}
+
+/*----------------------------------------------------------------------------*/
+
+static inline void museair_stream_init(museair_stream_t* s, const uint64_t seed) {
+    _museair_tower_init(&s->state[0], seed);
+    s->ring_prev = MUSEAIR_RING_PREV;
+    s->seed = seed;
+    s->len = 0;
+    s->buffered = 0;
+}
+
+static inline void museair_stream_update(museair_stream_t* s, const void* in, const size_t len) {
+    _museair_stream_update(false, s, in, len);
+}
+static inline uint64_t museair_stream_digest(const museair_stream_t* s) {
+    return _museair_stream_digest(false, s);
+}
+static inline uint64_t museair_stream_digest_128(const museair_stream_t* s, uint64_t* upper_half) {
+    return _museair_stream_digest_128(false, s, upper_half);
+}
+
+static inline void museair_bfast_stream_update(museair_stream_t* s, const void* in, const size_t len) {
+    _museair_stream_update(true, s, in, len);
+}
+static inline uint64_t museair_bfast_stream_digest(const museair_stream_t* s) {
+    return _museair_stream_digest(true, s);
+}
+static inline uint64_t museair_bfast_stream_digest_128(const museair_stream_t* s, uint64_t* upper_half) {
+    return _museair_stream_digest_128(true, s, upper_half);
+}
+
+/*----------------------------------------------------------------------------*/
+
+#if MUSEAIR_HAS_IOVEC
+
+// Fragments are fed to a stream, only the bytes straddling a 96 bytes block boundary are staged.
+static FORCE_INLINE uint64_t
+_museair_hash_iov(const bool BFast, const bool B128, const struct iovec* iov, int cnt, uint64_t seed, uint64_t* hi) {
+    if (cnt == 1) {
+        return B128 ? _museair_hash_128(BFast, iov[0].iov_base, iov[0].iov_len, seed, hi)
+                    : _museair_hash(BFast, iov[0].iov_base, iov[0].iov_len, seed);
+    }
+    museair_stream_t s;
+    museair_stream_init(&s, seed);
+    for (int n = 0; n < cnt; n++) {
+        _museair_stream_update(BFast, &s, iov[n].iov_base, iov[n].iov_len);
+    }
+    return B128 ? _museair_stream_digest_128(BFast, &s, hi) : _museair_stream_digest(BFast, &s);
+}
+
+// Same as hashing the concatenation of the `cnt` fragments.
+static inline uint64_t museair_hash_iov(const struct iovec* iov, const int cnt, const uint64_t seed) {
+    return _museair_hash_iov(false, false, iov, cnt, seed, NULL);
+}
+static inline uint64_t museair_hash_128_iov(const struct iovec* iov,
+                                            const int cnt,
+                                            const uint64_t seed,
+                                            uint64_t* upper_half) {
+    return _museair_hash_iov(false, true, iov, cnt, seed, upper_half);
+}
+static inline uint64_t museair_bfast_hash_iov(const struct iovec* iov, const int cnt, const uint64_t seed) {
+    return _museair_hash_iov(true, false, iov, cnt, seed, NULL);
+}
+static inline uint64_t museair_bfast_hash_128_iov(const struct iovec* iov,
+                                                  const int cnt,
+                                                  const uint64_t seed,
+                                                  uint64_t* upper_half) {
+    return _museair_hash_iov(true, true, iov, cnt, seed, upper_half);
+}
+
+#endif  // MUSEAIR_HAS_IOVEC
+
+/*----------------------------------------------------------------------------*/
+
+#if defined(__has_attribute)
+    #if __has_attribute(__no_sanitize_address__)
+        #define MUSEAIR_NO_SANITIZE_ADDRESS __attribute__((__no_sanitize_address__))
+    #endif
+#endif
+#ifndef MUSEAIR_NO_SANITIZE_ADDRESS
+    #define MUSEAIR_NO_SANITIZE_ADDRESS
+#endif
+
+static FORCE_INLINE int _museair_ctz64(uint64_t v) {
+#if defined(__GNUC__) || defined(__INTEL_COMPILER) || defined(__clang__)
+    return __builtin_ctzll(v);
+#elif defined(_MSC_VER) && defined(_M_X64)
+    unsigned long n;
+    _BitScanForward64(&n, v);
+    return (int)n;
+#else
+    int n = 0;
+    while (!(v & 1)) {
+        v >>= 1;
+        n++;
+    }
+    return n;
+#endif
+}
+
+#if defined(__SSE2__) || defined(_M_X64)
+// Bit `n` set if `w[n]` is zero, for 64 bytes at `w` aligned to 64. Bits of the `skip` first bytes may be set too.
+static MUSEAIR_NO_SANITIZE_ADDRESS FORCE_INLINE uint64_t _museair_nul_mask_64(const uint8_t* w, const size_t skip) {
+    (void)skip;
+    const __m128i zero = _mm_setzero_si128();
+    __m128i v0 = _mm_load_si128((const __m128i*)(w + 0x00)), v1 = _mm_load_si128((const __m128i*)(w + 0x10));
+    __m128i v2 = _mm_load_si128((const __m128i*)(w + 0x20)), v3 = _mm_load_si128((const __m128i*)(w + 0x30));
+    // Strings are mostly free of zeros, test all 64 bytes at once first.
+    __m128i m = _mm_min_epu8(_mm_min_epu8(v0, v1), _mm_min_epu8(v2, v3));
+    if (_museair_likely(!_mm_movemask_epi8(_mm_cmpeq_epi8(m, zero)))) {
+        return 0;
+    }
+    uint64_t m0 = (uint32_t)_mm_movemask_epi8(_mm_cmpeq_epi8(v0, zero));
+    uint64_t m1 = (uint32_t)_mm_movemask_epi8(_mm_cmpeq_epi8(v1, zero));
+    uint64_t m2 = (uint32_t)_mm_movemask_epi8(_mm_cmpeq_epi8(v2, zero));
+    uint64_t m3 = (uint32_t)_mm_movemask_epi8(_mm_cmpeq_epi8(v3, zero));
+    return m0 | m1 << 16 | m2 << 32 | m3 << 48;
+}
+    #define MUSEAIR_STRNLEN_STRIDE 64
+#else
+// Bit `8n+7` set if `w[n]` is zero, for 8 bytes at `w` aligned to 8, but for the `skip` first bytes. Those are made
+// non-zero before the test, the borrow of a zero would flag the byte above it.
+static MUSEAIR_NO_SANITIZE_ADDRESS FORCE_INLINE uint64_t _museair_nul_mask_64(const uint8_t* w, const size_t skip) {
+    uint64_t v = _museair_read_u64(w) | ((UINT64_C(1) << (8 * skip)) - 1);
+    return (v - UINT64_C(0x0101010101010101)) & ~v & UINT64_C(0x8080808080808080);
+}
+    #define MUSEAIR_STRNLEN_STRIDE 8
+#endif
+
+// `min(strlen(p), max)`, reading whole aligned strides: they never cross a page boundary, so bytes past the
+// terminator may be read but never fault.
+static MUSEAIR_NO_SANITIZE_ADDRESS NEVER_INLINE size_t _museair_strnlen(const uint8_t* p, const size_t max) {
+    const size_t stride = MUSEAIR_STRNLEN_STRIDE, unit = 64 / MUSEAIR_STRNLEN_STRIDE;  // mask bits per byte.
+    size_t mis = (size_t)((uintptr_t)p & (stride - 1));
+    const uint8_t* w = p - mis;
+    // Bytes before `p` are shifted out of the mask.
+    uint64_t zeros = _museair_nul_mask_64(w, mis) >> (unit * mis);
+    size_t n = 0;
+    for (;;) {
+        if (zeros) {
+            n += (size_t)_museair_ctz64(zeros) / unit;
+            return n < max ? n : max;
+        }
+        n += stride - (n ? 0 : mis);
+        if (n >= max) {
+            return max;
+        }
+        zeros = _museair_nul_mask_64(p + n, 0);
+    }
+}
+
+// Bytes scanned for the terminator ahead of hashing, small enough to still be in L1 when `layer_12` reads them.
+#ifndef MUSEAIR_CSTR_SCAN
+    #define MUSEAIR_CSTR_SCAN (8 * 12 * 16)
+#endif
+
+static FORCE_INLINE uint64_t
+_museair_hash_cstr(const bool BFast, const bool B128, const char* str, const uint64_t seed, uint64_t* hi, size_t* len) {
+    const uint8_t* p = (const uint8_t*)str;
+    size_t q = _museair_strnlen(p, 8 * 12);
+    if (q < 8 * 12) {
+        if (len) {
+            *len = q;
+        }
+        return B128 ? _museair_hash_128(BFast, p, q, seed, hi) : _museair_hash(BFast, p, q, seed);
+    }
+
+    uint64_t state[6], ring_prev;
+    _museair_tower_init(&state[0], seed);
+    _museair_tower_layer_12_enter(&state[0], seed, &ring_prev);
+    // `q` bytes from `p` are known to precede the terminator.
+    for (;;) {
+        do {
+            _museair_layer_12(BFast, &state[0], p, &ring_prev);
+            p += 8 * 12;
+            q -= 8 * 12;
+        } while (q >= 8 * 12);
+        size_t want = MUSEAIR_CSTR_SCAN - q, n = _museair_strnlen(p + q, want);
+        q += n;
+        if (n < want) {
+            break;
+        }
+    }
+    while (q >= 8 * 12) {
+        _museair_layer_12(BFast, &state[0], p, &ring_prev);
+        p += 8 * 12;
+        q -= 8 * 12;
+    }
+    _museair_tower_layer_12_leave(&state[0], ring_prev);
+
+    uint64_t i, j, k;
+    size_t total = (size_t)(p - (const uint8_t*)str) + q;
+    _museair_tower_tail(BFast, &state[0], p, q, total, &i, &j, &k);
+    if (len) {
+        *len = total;
+    }
+    if (!B128) {
+        _museair_epi_loong(BFast, &i, &j, &k);
+    } else {
+        _museair_epi_loong_128(BFast, &i, &j, &k);
+    }
+#if MUSEAIR_BSWAP > 0
+    i = _museair_bswap_64(i);
+    j = _museair_bswap_64(j);
+#endif
+    if (B128) {
+        *hi = j;
+    }
+    return i;
+}
+
+// Same as `museair_hash(str, strlen(str), seed)` in a single pass, `len` (may be NULL) receives `strlen(str)`.
+static inline uint64_t museair_hash_cstr(const char* str, const uint64_t seed, size_t* len) {
+    return _museair_hash_cstr(false, false, str, seed, NULL, len);
+}
+static inline uint64_t museair_hash_128_cstr(const char* str, const uint64_t seed, uint64_t* upper_half, size_t* len) {
+    return _museair_hash_cstr(false, true, str, seed, upper_half, len);
+}
+static inline uint64_t museair_bfast_hash_cstr(const char* str, const uint64_t seed, size_t* len) {
+    return _museair_hash_cstr(true, false, str, seed, NULL, len);
+}
+static inline uint64_t museair_bfast_hash_128_cstr(const char* str,
+                                                   const uint64_t seed,
+                                                   uint64_t* upper_half,
+                                                   size_t* len) {
+    return _museair_hash_cstr(true, true, str, seed, upper_half, len);
+}
+
+/*----------------------------------------------------------------------------*/
+
+// Copies each 96 bytes block right after `layer_12` has read it, so payloads are read from memory once.
+static FORCE_INLINE uint64_t _museair_copy_and_hash(const bool BFast,
+                                                    const bool B128,
+                                                    void* dst,
+                                                    const void* src,
+                                                    const size_t len,
+                                                    const uint64_t seed,
+                                                    uint64_t* hi) {
+    const uint8_t* p = (const uint8_t*)src;
+    uint8_t* d = (uint8_t*)dst;
+    if (len < 8 * 12) {
+        memcpy(d, p, len);
+        return B128 ? _museair_hash_128(BFast, p, len, seed, hi) : _museair_hash(BFast, p, len, seed);
+    }
+
+    uint64_t state[6], ring_prev;
+    size_t q = len;
+    _museair_tower_init(&state[0], seed);
+    _museair_tower_layer_12_enter(&state[0], seed, &ring_prev);
+    do {
+        _museair_layer_12(BFast, &state[0], p, &ring_prev);
+        memcpy(d, p, 8 * 12);
+        p += 8 * 12;
+        d += 8 * 12;
+        q -= 8 * 12;
+    } while (_museair_likely(q >= 8 * 12));
+    _museair_tower_layer_12_leave(&state[0], ring_prev);
+
+    uint64_t i, j, k;
+    memcpy(d, p, q);
+    _museair_tower_tail(BFast, &state[0], p, q, len, &i, &j, &k);
+    if (!B128) {
+        _museair_epi_loong(BFast, &i, &j, &k);
+    } else {
+        _museair_epi_loong_128(BFast, &i, &j, &k);
+    }
+#if MUSEAIR_BSWAP > 0
+    i = _museair_bswap_64(i);
+    j = _museair_bswap_64(j);
+#endif
+    if (B128) {
+        *hi = j;
+    }
+    return i;
+}
+
+// `memcpy(dst, src, len)` and `museair_hash(src, len, seed)` in a single pass. `dst` and `src` must not overlap.
+static inline uint64_t museair_copy_and_hash(void* dst, const void* src, const size_t len, const uint64_t seed) {
+    return _museair_copy_and_hash(false, false, dst, src, len, seed, NULL);
+}
+static inline uint64_t museair_copy_and_hash_128(void* dst,
+                                                 const void* src,
+                                                 const size_t len,
+                                                 const uint64_t seed,
+                                                 uint64_t* upper_half) {
+    return _museair_copy_and_hash(false, true, dst, src, len, seed, upper_half);
+}
+static inline uint64_t museair_bfast_copy_and_hash(void* dst, const void* src, const size_t len, const uint64_t seed) {
+    return _museair_copy_and_hash(true, false, dst, src, len, seed, NULL);
+}
+static inline uint64_t museair_bfast_copy_and_hash_128(void* dst,
+                                                       const void* src,
+                                                       const size_t len,
+                                                       const uint64_t seed,
+                                                       uint64_t* upper_half) {
+    return _museair_copy_and_hash(true, true, dst, src, len, seed, upper_half);
+}
+
+/*----------------------------------------------------------------------------*/
+
+// ASCII lowercase of the 8 bytes in `v`, other bytes (including non-ASCII ones) are left as they are.
+static FORCE_INLINE uint64_t _museair_fold_u64(uint64_t v) {
+    const uint64_t highs = UINT64_C(0x8080808080808080), lows = ~highs;
+    uint64_t ge_a = (v & lows) + UINT64_C(0x3f3f3f3f3f3f3f3f);  // high bit set for 7-bit values >= 'A'.
+    uint64_t gt_z = (v & lows) + UINT64_C(0x2525252525252525);  // high bit set for 7-bit values > 'Z'.
+    return v | ((ge_a & ~gt_z & ~v & highs) >> 2);
+}
+
+static FORCE_INLINE void _museair_fold(uint8_t* out, const uint8_t* in, const size_t len) {
+    uint64_t v;
+    if (len < 8) {
+        for (size_t n = 0; n < len; n++) {
+            out[n] = (uint8_t)(in[n] - 'A') < 26 ? (uint8_t)(in[n] | 0x20) : in[n];
+        }
+        return;
+    }
+    for (size_t n = 0; n + 8 <= len; n += 8) {
+        memcpy(&v, in + n, 8);
+        v = _museair_fold_u64(v);
+        memcpy(out + n, &v, 8);
+    }
+    // Last word overlaps the previous one, folding is idempotent.
+    memcpy(&v, in + len - 8, 8);
+    v = _museair_fold_u64(v);
+    memcpy(out + len - 8, &v, 8);
+}
+
+// Each 96 bytes block is folded into a stack buffer right before `layer_12` reads it, the input is read once.
+static FORCE_INLINE uint64_t _museair_hash_nocase(const bool BFast,
+                                                  const bool B128,
+                                                  const void* in,
+                                                  const size_t len,
+                                                  const uint64_t seed,
+                                                  uint64_t* hi) {
+    const uint8_t* p = (const uint8_t*)in;
+    uint8_t block[8 * 12];
+    if (len < 8 * 12) {
+        _museair_fold(&block[0], p, len);
+        return B128 ? _museair_hash_128(BFast, &block[0], len, seed, hi) : _museair_hash(BFast, &block[0], len, seed);
+    }
+
+    uint64_t state[6], ring_prev;
+    size_t q = len;
+    _museair_tower_init(&state[0], seed);
+    _museair_tower_layer_12_enter(&state[0], seed, &ring_prev);
+    do {
+        _museair_fold(&block[0], p, 8 * 12);
+        _museair_layer_12(BFast, &state[0], &block[0], &ring_prev);
+        p += 8 * 12;
+        q -= 8 * 12;
+    } while (_museair_likely(q >= 8 * 12));
+    _museair_tower_layer_12_leave(&state[0], ring_prev);
+
+    uint64_t i, j, k;
+    _museair_fold(&block[0], p, q);
+    _museair_tower_tail(BFast, &state[0], &block[0], q, len, &i, &j, &k);
+    if (!B128) {
+        _museair_epi_loong(BFast, &i, &j, &k);
+    } else {
+        _museair_epi_loong_128(BFast, &i, &j, &k);
+    }
+#if MUSEAIR_BSWAP > 0
+    i = _museair_bswap_64(i);
+    j = _museair_bswap_64(j);
+#endif
+    if (B128) {
+        *hi = j;
+    }
+    return i;
+}
+
+// ASCII case-insensitive hashing: same as `museair_hash` of the input with 'A'-'Z' mapped to 'a'-'z'.
+static inline uint64_t museair_hash_nocase(const void* in, const size_t len, const uint64_t seed) {
+    return _museair_hash_nocase(false, false, in, len, seed, NULL);
+}
+static inline uint64_t museair_hash_128_nocase(const void* in,
+                                               const size_t len,
+                                               const uint64_t seed,
+                                               uint64_t* upper_half) {
+    return _museair_hash_nocase(false, true, in, len, seed, upper_half);
+}
+static inline uint64_t museair_bfast_hash_nocase(const void* in, const size_t len, const uint64_t seed) {
+    return _museair_hash_nocase(true, false, in, len, seed, NULL);
+}
+static inline uint64_t museair_bfast_hash_128_nocase(const void* in,
+                                                     const size_t len,
+                                                     const uint64_t seed,
+                                                     uint64_t* upper_half) {
+    return _museair_hash_nocase(true, true, in, len, seed, upper_half);
+}
+
+/*----------------------------------------------------------------------------*/
+
+// Keys per group in the batch functions, a group whose keys are all short takes no per-key length branch.
+#ifndef MUSEAIR_BATCH_LANES
+    #define MUSEAIR_BATCH_LANES 4
+#endif
+
+static FORCE_INLINE void _museair_store_digest(const bool B128, uint64_t* out, size_t n, uint64_t i, uint64_t j) {
+#if MUSEAIR_BSWAP > 0
+    i = _museair_bswap_64(i);
+    j = _museair_bswap_64(j);
+#endif
+    if (!B128) {
+        out[n] = i;
+    } else {
+        out[2 * n + 0] = i;
+        out[2 * n + 1] = j;
+    }
+}
+
+static FORCE_INLINE void _museair_hash_one(const bool BFast,
+                                           const bool B128,
+                                           const void* in,
+                                           const size_t len,
+                                           const uint64_t seed,
+                                           uint64_t* out,
+                                           const size_t n) {
+    if (!B128) {
+        out[n] = _museair_hash(BFast, in, len, seed);
+    } else {
+        out[2 * n + 0] = _museair_hash_128(BFast, in, len, seed, &out[2 * n + 1]);
+    }
+}
+
+// Hashes `MUSEAIR_BATCH_LANES` short keys back to back, without the length branch of `_museair_hash`.
+static FORCE_INLINE void _museair_hash_short_lanes(const bool BFast,
+                                                   const bool B128,
+                                                   const void* const* keys,
+                                                   const size_t* lens,
+                                                   const uint64_t seed,
+                                                   uint64_t* out,
+                                                   const size_t n) {
+    for (int l = 0; l < MUSEAIR_BATCH_LANES; l++) {
+        uint64_t i, j;
+        if (!B128) {
+            _museair_hash_short((const uint8_t*)keys[l], lens[l], seed, &i, &j);
+        } else {
+            _museair_hash_short_128(BFast, (const uint8_t*)keys[l], lens[l], seed, &i, &j);
+        }
+        _museair_store_digest(B128, out, n + l, i, j);
+    }
+}
+
+// Digests of `n` keys into `out[n]`, or `out[2 * n]` (lower half) and `out[2 * n + 1]` (upper half) for each key
+// with `B128`, for the companion headers that hash a batch of keys before prefetching their slots. The keys are
+// hashed one after another, no faster than a loop of `museair_hash`, so this is not a public entry point.
+static FORCE_INLINE void _museair_hash_batch(const bool BFast,
+                                             const bool B128,
+                                             const void* const* keys,
+                                             const size_t* lens,
+                                             const size_t n,
+                                             const uint64_t seed,
+                                             uint64_t* out) {
+    const size_t whole = n - n % MUSEAIR_BATCH_LANES;
+    size_t b = 0;
+    for (; b < whole; b += MUSEAIR_BATCH_LANES) {
+        bool all_short = true;
+        for (int l = 0; l < MUSEAIR_BATCH_LANES; l++) {
+            all_short &= lens[b + l] <= 16;
+        }
+        if (_museair_likely(all_short)) {
+            _museair_hash_short_lanes(BFast, B128, &keys[b], &lens[b], seed, out, b);
+        } else {
+            for (int l = 0; l < MUSEAIR_BATCH_LANES; l++) {
+                _museair_hash_one(BFast, B128, keys[b + l], lens[b + l], seed, out, b + l);
+            }
+        }
+    }
+    for (; b < n; b++) {
+        _museair_hash_one(BFast, B128, keys[b], lens[b], seed, out, b);
+    }
+}
+
+/*----------------------------------------------------------------------------*/
+
+// Rows of a column are independent, so the multiplies of consecutive rows overlap in the pipeline. With `width`
+// known at compile time, `_museair_read_short` and the length branches of keys up to 16 bytes fold away.
+static FORCE_INLINE void _museair_hash_column_rows(const bool BFast,
+                                                   const uint8_t* base,
+                                                   const size_t width,
+                                                   const size_t n,
+                                                   const uint64_t* prev,
+                                                   const uint64_t seed,
+                                                   uint64_t* out) {
+    for (size_t r = 0; r < n; r++) {
+        const uint8_t* p = base + r * width;
+        const uint64_t s = prev ? prev[r] : seed;
+        if (width <= 16) {
+            uint64_t i, j;
+            _museair_hash_short(p, width, s, &i, &j);
+            _museair_store_digest(false, out, r, i, j);
+        } else if (width < 8 * 12) {
+            // No `layer_12` loop, the whole tower is small enough to inline.
+            uint64_t i, j, k;
+            _museair_tower_loong(BFast, p, width, s, &i, &j, &k);
+            _museair_epi_loong(BFast, &i, &j, &k);
+            _museair_store_digest(false, out, r, i, j);
+        } else {
+            out[r] = _museair_hash(BFast, p, width, s);
+        }
+    }
+}
+
+static FORCE_INLINE void _museair_hash_column_fixed(const bool BFast,
+                                                    const uint8_t* base,
+                                                    const size_t width,
+                                                    const size_t n,
+                                                    const uint64_t* prev,
+                                                    const uint64_t seed,
+                                                    uint64_t* out) {
+    if (prev) {
+        _museair_hash_column_rows(BFast, base, width, n, prev, seed, out);
+    } else {
+        _museair_hash_column_rows(BFast, base, width, n, NULL, seed, out);
+    }
+}
+
+static FORCE_INLINE void _museair_hash_column(const bool BFast,
+                                              const void* base,
+                                              const size_t width,
+                                              const size_t n,
+                                              const uint64_t* prev,
+                                              const uint64_t seed,
+                                              uint64_t* out) {
+    const uint8_t* p = (const uint8_t*)base;
+    switch (width) {
+        case 1:
+            _museair_hash_column_fixed(BFast, p, 1, n, prev, seed, out);
+            return;
+        case 2:
+            _museair_hash_column_fixed(BFast, p, 2, n, prev, seed, out);
+            return;
+        case 4:
+            _museair_hash_column_fixed(BFast, p, 4, n, prev, seed, out);
+            return;
+        case 8:
+            _museair_hash_column_fixed(BFast, p, 8, n, prev, seed, out);
+            return;
+        case 12:
+            _museair_hash_column_fixed(BFast, p, 12, n, prev, seed, out);
+            return;
+        case 16:
+            _museair_hash_column_fixed(BFast, p, 16, n, prev, seed, out);
+            return;
+        case 24:
+            _museair_hash_column_fixed(BFast, p, 24, n, prev, seed, out);
+            return;
+        case 32:
+            _museair_hash_column_fixed(BFast, p, 32, n, prev, seed, out);
+            return;
+        default:
+            _museair_hash_column_fixed(BFast, p, width, n, prev, seed, out);
+            return;
+    }
+}
+
+// Variable-length rows in Arrow layout: row `r` is `data[offsets[r] .. offsets[r + 1])`.
+static FORCE_INLINE void _museair_hash_column_var_rows(const bool BFast,
+                                                       const bool Large,
+                                                       const uint8_t* data,
+                                                       const void* offsets,
+                                                       const size_t n,
+                                                       const uint64_t* prev,
+                                                       const uint64_t seed,
+                                                       uint64_t* out) {
+    const int32_t* o32 = (const int32_t*)offsets;
+    const int64_t* o64 = (const int64_t*)offsets;
+    size_t start = Large ? (size_t)o64[0] : (size_t)o32[0];
+    for (size_t r = 0; r < n; r++) {
+        const size_t end = Large ? (size_t)o64[r + 1] : (size_t)o32[r + 1];
+        out[r] = _museair_hash(BFast, data + start, end - start, prev ? prev[r] : seed);
+        start = end;
+    }
+}
+
+static FORCE_INLINE void _museair_hash_column_var(const bool BFast,
+                                                  const bool Large,
+                                                  const void* data,
+                                                  const void* offsets,
+                                                  const size_t n,
+                                                  const uint64_t* prev,
+                                                  const uint64_t seed,
+                                                  uint64_t* out) {
+    if (prev) {
+        _museair_hash_column_var_rows(BFast, Large, (const uint8_t*)data, offsets, n, prev, seed, out);
+    } else {
+        _museair_hash_column_var_rows(BFast, Large, (const uint8_t*)data, offsets, n, NULL, seed, out);
+    }
+}
+
+/*----------------------------------------------------------------------------*/
+
+// Column hashing for hash joins and group-bys: `out[r]` is `museair_hash(row r, width, seed)`. When `prev` is not
+// NULL, `prev[r]` is used as the seed of row `r` instead, chaining the digests of multi-column keys. `out` may be
+// the same array as `prev`.
+//
+// Fixed-width rows are `width` bytes each, packed from `base`. Widths 1, 2, 4, 8, 12, 16, 24 and 32 are specialized.
+static inline void museair_hash_column(const void* base,
+                                       const size_t width,
+                                       const size_t n,
+                                       const uint64_t* prev,
+                                       const uint64_t seed,
+                                       uint64_t* out) {
+    _museair_hash_column(false, base, width, n, prev, seed, out);
+}
+static inline void museair_bfast_hash_column(const void* base,
+                                             const size_t width,
+                                             const size_t n,
+                                             const uint64_t* prev,
+                                             const uint64_t seed,
+                                             uint64_t* out) {
+    _museair_hash_column(true, base, width, n, prev, seed, out);
+}
+
+// Variable-length rows given `n + 1` Arrow offsets into `data`, 32-bit or, for the "large" types, 64-bit.
+static inline void museair_hash_column_var(const void* data,
+                                           const int32_t* offsets,
+                                           const size_t n,
+                                           const uint64_t* prev,
+                                           const uint64_t seed,
+                                           uint64_t* out) {
+    _museair_hash_column_var(false, false, data, offsets, n, prev, seed, out);
+}
+static inline void museair_hash_column_var_large(const void* data,
+                                                 const int64_t* offsets,
+                                                 const size_t n,
+                                                 const uint64_t* prev,
+                                                 const uint64_t seed,
+                                                 uint64_t* out) {
+    _museair_hash_column_var(false, true, data, offsets, n, prev, seed, out);
+}
+static inline void museair_bfast_hash_column_var(const void* data,
+                                                 const int32_t* offsets,
+                                                 const size_t n,
+                                                 const uint64_t* prev,
+                                                 const uint64_t seed,
+                                                 uint64_t* out) {
+    _museair_hash_column_var(true, false, data, offsets, n, prev, seed, out);
+}
+static inline void museair_bfast_hash_column_var_large(const void* data,
+                                                       const int64_t* offsets,
+                                                       const size_t n,
+                                                       const uint64_t* prev,
+                                                       const uint64_t seed,
+                                                       uint64_t* out) {
+    _museair_hash_column_var(true, true, data, offsets, n, prev, seed, out);
+}
+
+/*----------------------------------------------------------------------------*/
+
+// Towers advanced together by the multi-seed functions, more seeds take another pass over the input.
+#ifndef MUSEAIR_MULTISEED_TOWERS
+    #define MUSEAIR_MULTISEED_TOWERS 16
+#endif
+
+// Blocks of 96 bytes per chunk, each chunk is read from memory once and then from L1 by every tower.
+#ifndef MUSEAIR_MULTISEED_CHUNK
+    #define MUSEAIR_MULTISEED_CHUNK 16
+#endif
+
+// Out of line so that the state of one tower stays in registers across the chunk.
+static NEVER_INLINE void _museair_multiseed_chunk(const bool BFast,
+                                                  uint64_t* state,
+                                                  uint64_t* ring_prev,
+                                                  const uint8_t* p,
+                                                  const size_t blocks) {
+    uint64_t s[6] = {state[0], state[1], state[2], state[3], state[4], state[5]};
+    uint64_t r = *ring_prev;
+    for (size_t n = 0; n < blocks; n++) {
+        _museair_layer_12(BFast, &s[0], p + n * 8 * 12, &r);
+    }
+    memcpy(state, &s[0], sizeof(s));
+    *ring_prev = r;
+}
+
+// Up to `MUSEAIR_MULTISEED_TOWERS` towers, each advanced through a whole chunk at a time.
+static FORCE_INLINE void _museair_hash_multiseed_loong(const bool BFast,
+                                                       const bool B128,
+                                                       const uint8_t* bytes,
+                                                       const size_t len,
+                                                       const uint64_t* seeds,
+                                                       const size_t towers,
+                                                       uint64_t* out) {
+    uint64_t state[MUSEAIR_MULTISEED_TOWERS][6], ring_prev[MUSEAIR_MULTISEED_TOWERS];
+    const uint8_t* p = bytes;
+    size_t q = len;
+    for (size_t t = 0; t < towers; t++) {
+        _museair_tower_init(&state[t][0], seeds[t]);
+    }
+
+    if (q >= 8 * 12) {
+        for (size_t t = 0; t < towers; t++) {
+            _museair_tower_layer_12_enter(&state[t][0], seeds[t], &ring_prev[t]);
+        }
+        const size_t blocks = q / (8 * 12);
+        for (size_t b = 0; b < blocks; b += MUSEAIR_MULTISEED_CHUNK) {
+            const size_t m = blocks - b < MUSEAIR_MULTISEED_CHUNK ? blocks - b : MUSEAIR_MULTISEED_CHUNK;
+            for (size_t t = 0; t < towers; t++) {
+                _museair_multiseed_chunk(BFast, &state[t][0], &ring_prev[t], p, m);
+            }
+            p += m * 8 * 12;
+        }
+        q -= blocks * 8 * 12;
+        for (size_t t = 0; t < towers; t++) {
+            _museair_tower_layer_12_leave(&state[t][0], ring_prev[t]);
+        }
+    }
+
+    for (size_t t = 0; t < towers; t++) {
+        uint64_t i, j, k;
+        _museair_tower_tail(BFast, &state[t][0], p, q, len, &i, &j, &k);
+        if (!B128) {
+            _museair_epi_loong(BFast, &i, &j, &k);
+        } else {
+            _museair_epi_loong_128(BFast, &i, &j, &k);
+        }
+        _museair_store_digest(B128, out, t, i, j);
+    }
+}
+
+static FORCE_INLINE void _museair_hash_multiseed(const bool BFast,
+                                                 const bool B128,
+                                                 const void* in,
+                                                 const size_t len,
+                                                 const uint64_t* seeds,
+                                                 const size_t k,
+                                                 uint64_t* out) {
+    const uint8_t* p = (const uint8_t*)in;
+    if (len <= 16) {
+        // Read once, only the seed dependent part of `_museair_tower_short` is repeated.
+        uint64_t i0, j0;
+        _museair_read_short(p, len, &i0, &j0);
+        for (size_t t = 0; t < k; t++) {
+            uint64_t lo, hi, i = i0, j = j0;
+            _museair_wmul(&lo, &hi, seeds[t] ^ MUSEAIR_SECRET[0], len ^ MUSEAIR_SECRET[1]);
+            i ^= lo ^ len;
+            j ^= hi ^ seeds[t];
+            if (!B128) {
+                _museair_epi_short(&i, &j);
+            } else {
+                _museair_epi_short_128(BFast, &i, &j);
+            }
+            _museair_store_digest(B128, out, t, i, j);
+        }
+        return;
+    }
+    if (len >= 8 * 12 && len <= MUSEAIR_MULTISEED_CHUNK * 8 * 12) {
+        // Stays in L1 after the first seed, sharing its loads does not pay for keeping all the towers in memory.
+        for (size_t t = 0; t < k; t++) {
+            _museair_hash_one(BFast, B128, p, len, seeds[t], out, t);
+        }
+        return;
+    }
+    for (size_t t = 0; t < k; t += MUSEAIR_MULTISEED_TOWERS) {
+        const size_t n = k - t < MUSEAIR_MULTISEED_TOWERS ? k - t : MUSEAIR_MULTISEED_TOWERS;
+        _museair_hash_multiseed_loong(BFast, B128, p, len, &seeds[t], n, B128 ? &out[2 * t] : &out[t]);
+    }
+}
+
+// Same as `out[t] = museair_hash(in, len, seeds[t])` for each of the `k` seeds, reading the input once per
+// `MUSEAIR_MULTISEED_TOWERS` seeds. The 128-bit variants write `out[2 * t]` and `out[2 * t + 1]`.
+static inline void museair_hash_multiseed(const void* in,
+                                          const size_t len,
+                                          const uint64_t* seeds,
+                                          const size_t k,
+                                          uint64_t* out) {
+    _museair_hash_multiseed(false, false, in, len, seeds, k, out);
+}
+static inline void museair_hash_128_multiseed(const void* in,
+                                              const size_t len,
+                                              const uint64_t* seeds,
+                                              const size_t k,
+                                              uint64_t* out) {
+    _museair_hash_multiseed(false, true, in, len, seeds, k, out);
+}
+static inline void museair_bfast_hash_multiseed(const void* in,
+                                                const size_t len,
+                                                const uint64_t* seeds,
+                                                const size_t k,
+                                                uint64_t* out) {
+    _museair_hash_multiseed(true, false, in, len, seeds, k, out);
+}
+static inline void museair_bfast_hash_128_multiseed(const void* in,
+                                                    const size_t len,
+                                                    const uint64_t* seeds,
+                                                    const size_t k,
+                                                    uint64_t* out) {
+    _museair_hash_multiseed(true, true, in, len, seeds, k, out);
+}
+
+#endif  // MUSEAIR_H
@@ -0,0 +1,387 @@
+/*
+ * C++ interface of MuseAir, requires C++17.
+ *
+ * SPDX-License-Identifier: Apache-2.0 OR MIT
+ *
+ * `museair::hasher` is a transparent hash functor for standard and absl-like containers:
+ *
+ *     std::unordered_map<std::string, int, museair::hasher, museair::equal_to> m;
+ *     m.find(std::string_view("key"));  // no temporary std::string, heterogeneous lookup needs C++20 here.
+ *
+ * It accepts strings, byte spans, integers, enums and pointers, which are hashed by their object representation.
+ * User-defined types without padding can get a MuseAir `std::hash` with `MUSEAIR_SPECIALIZE_STD_HASH`.
+ * Everything goes through the inline `museair_hash` / `museair_bfast_hash`, so short keys are hashed without
+ * any call.
+ *
+ * `museair::constexpr_hash` / `museair::constexpr_bfast_hash` (and the `_museair` literal) compute the same
+ * digests in constant expressions, for switching on hashed strings:
+ *
+ *     using namespace museair::literals;
+ *     switch (museair::hasher()(command)) {
+ *         case "GET"_museair: ...
+ *         case "PUT"_museair: ...
+ *     }
+ */
+
+#ifndef MUSEAIR_HPP
+#define MUSEAIR_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#if __cplusplus >= 202002L || (defined(_MSVC_LANG) && _MSVC_LANG >= 202002L)
+    #include <span>
+    #define MUSEAIR_HAS_SPAN 1
+#else
+    #define MUSEAIR_HAS_SPAN 0
+#endif
+
+#include "museair.h"
+
+namespace museair {
+
+// Types whose object representation is their value, so equal values hash equal.
+template <typename T>
+inline constexpr bool is_bytewise_hashable_v =
+    std::is_trivially_copyable_v<T> && std::has_unique_object_representations_v<T> && !std::is_array_v<T>;
+
+// Scalars accepted by the hashers directly, `char` pointers are hashed as strings instead.
+template <typename T>
+inline constexpr bool is_hashable_scalar_v =
+    std::is_scalar_v<T> && is_bytewise_hashable_v<T> &&
+    !std::is_same_v<std::remove_cv_t<std::remove_pointer_t<T>>, char>;
+
+template <bool BFast>
+class basic_hasher {
+   public:
+    using is_transparent = void;
+
+    constexpr basic_hasher() noexcept = default;
+    constexpr explicit basic_hasher(std::uint64_t seed) noexcept : seed_(seed) {}
+
+    constexpr std::uint64_t seed() const noexcept { return seed_; }
+
+    std::size_t operator()(const void* in, std::size_t len) const noexcept {
+        return static_cast<std::size_t>(_museair_hash(BFast, in, len, seed_));
+    }
+
+    std::size_t operator()(std::string_view s) const noexcept { return (*this)(s.data(), s.size()); }
+    std::size_t operator()(const std::string& s) const noexcept { return (*this)(s.data(), s.size()); }
+    std::size_t operator()(const char* s) const noexcept { return (*this)(std::string_view(s)); }
+#if MUSEAIR_HAS_SPAN
+    std::size_t operator()(std::span<const std::byte> s) const noexcept { return (*this)(s.data(), s.size()); }
+#endif
+
+    template <typename T, typename = std::enable_if_t<is_hashable_scalar_v<T>>>
+    std::size_t operator()(const T& v) const noexcept {
+        return (*this)(&v, sizeof(T));
+    }
+
+   private:
+    std::uint64_t seed_ = 0;
+};
+
+using hasher = basic_hasher<false>;
+using bfast_hasher = basic_hasher<true>;
+
+// Transparent key equality to pair with the hashers for heterogeneous lookup.
+using equal_to = std::equal_to<>;
+
+// Drop-in for `std::hash<T>` in container template arguments.
+template <typename T>
+struct hash : hasher {};
+
+/*----------------------------------------------------------------------------*/
+
+#if __cplusplus >= 202002L || (defined(_MSVC_LANG) && _MSVC_LANG >= 202002L)
+    #define MUSEAIR_CONSTEVAL consteval
+#else
+    #define MUSEAIR_CONSTEVAL constexpr
+#endif
+
+// Constant-evaluable mirror of "museair.h", byte loads and 64x64 -> 128 multiplies are spelled out portably.
+namespace constexpr_detail {
+
+inline constexpr std::uint64_t SECRET[6] = {
+    UINT64_C(0x5ae31e589c56e17a), UINT64_C(0x96d7bb04e64f6da9), UINT64_C(0x7ab1006b26f9eb64),
+    UINT64_C(0x21233394220b8457), UINT64_C(0x047cb9557c9f3b43), UINT64_C(0xd24f2590c0bcee28),
+};
+inline constexpr std::uint64_t RING_PREV = UINT64_C(0x33ea8f71bb6016d8);
+
+constexpr std::uint64_t bswap_64(std::uint64_t v) {
+    std::uint64_t r = 0;
+    for (int n = 0; n < 8; n++, v >>= 8) {
+        r = (r << 8) | (v & 0xff);
+    }
+    return r;
+}
+
+constexpr std::uint64_t read_u64(const char* p) {
+    std::uint64_t v = 0;
+    for (int n = 7; n >= 0; n--) {
+        v = (v << 8) | static_cast<std::uint8_t>(p[n]);
+    }
+    return v;
+}
+
+constexpr std::uint64_t read_u32(const char* p) {
+    std::uint64_t v = 0;
+    for (int n = 3; n >= 0; n--) {
+        v = (v << 8) | static_cast<std::uint8_t>(p[n]);
+    }
+    return v;
+}
+
+constexpr void read_short(const char* bytes, std::size_t len, std::uint64_t& i, std::uint64_t& j) {
+    if (len >= 4) {
+        std::size_t off = (len & 24) >> (len >> 3);
+        i = (read_u32(bytes) << 32) | read_u32(bytes + len - 4);
+        j = (read_u32(bytes + off) << 32) | read_u32(bytes + len - 4 - off);
+    } else if (len > 0) {
+        i = (std::uint64_t{static_cast<std::uint8_t>(bytes[0])} << 48) |
+            (std::uint64_t{static_cast<std::uint8_t>(bytes[len >> 1])} << 24) |
+            std::uint64_t{static_cast<std::uint8_t>(bytes[len - 1])};
+        j = 0;
+    } else {
+        i = 0;
+        j = 0;
+    }
+}
+
+constexpr std::uint64_t rotl(std::uint64_t v, unsigned n) {
+    return (v << n) | (v >> ((64 - n) & 63));
+}
+constexpr std::uint64_t rotr(std::uint64_t v, unsigned n) {
+    return (v >> n) | (v << ((64 - n) & 63));
+}
+
+constexpr void wmul(std::uint64_t& lo, std::uint64_t& hi, std::uint64_t a, std::uint64_t b) {
+    std::uint64_t a_lo = a & 0xffffffff, a_hi = a >> 32;
+    std::uint64_t b_lo = b & 0xffffffff, b_hi = b >> 32;
+    std::uint64_t ll = a_lo * b_lo, lh = a_lo * b_hi, hl = a_hi * b_lo, hh = a_hi * b_hi;
+    std::uint64_t mid = (ll >> 32) + (lh & 0xffffffff) + (hl & 0xffffffff);
+    lo = (mid << 32) | (ll & 0xffffffff);
+    hi = hh + (lh >> 32) + (hl >> 32) + (mid >> 32);
+}
+
+constexpr void chixx(std::uint64_t& t, std::uint64_t& u, std::uint64_t& v) {
+    std::uint64_t x = ~u & v;
+    std::uint64_t y = ~v & t;
+    std::uint64_t z = ~t & u;
+    t ^= x;
+    u ^= y;
+    v ^= z;
+}
+
+constexpr void frac_6(bool bfast, std::uint64_t& p, std::uint64_t& q, std::uint64_t in_p, std::uint64_t in_q) {
+    std::uint64_t lo = 0, hi = 0;
+    if (!bfast) {
+        p ^= in_p;
+        q ^= in_q;
+        wmul(lo, hi, p, q);
+        p ^= lo;
+        q ^= hi;
+    } else {
+        wmul(lo, hi, p ^ in_p, q ^ in_q);
+        p = lo;
+        q = hi;
+    }
+}
+
+constexpr void frac_3(bool bfast, std::uint64_t& p, std::uint64_t& q, std::uint64_t in) {
+    std::uint64_t lo = 0, hi = 0;
+    if (!bfast) {
+        q ^= in;
+        wmul(lo, hi, p, q);
+        p ^= lo;
+        q ^= hi;
+    } else {
+        wmul(lo, hi, p, q ^ in);
+        p = lo;
+        q = hi;
+    }
+}
+
+constexpr void layer_12(bool bfast, std::uint64_t* state, const char* p, std::uint64_t& ring_prev) {
+    std::uint64_t lo[6] = {}, hi[6] = {};
+    for (int n = 0; n < 6; n++) {
+        state[n] ^= read_u64(p + 8 * (2 * n));
+        state[(n + 1) % 6] ^= read_u64(p + 8 * (2 * n + 1));
+        wmul(lo[n], hi[n], state[n], state[(n + 1) % 6]);
+        std::uint64_t prev = n == 0 ? ring_prev : lo[n - 1];
+        state[n] = bfast ? prev ^ hi[n] : state[n] + (prev ^ hi[n]);
+    }
+    ring_prev = lo[5];
+}
+
+constexpr void layer_0(std::uint64_t* state,
+                       const char* p,
+                       std::size_t q,
+                       std::size_t len,
+                       std::uint64_t& i,
+                       std::uint64_t& j,
+                       std::uint64_t& k) {
+    if (q <= 8 * 2) {
+        read_short(p, q, i, j);
+        k = 0;
+    } else {
+        i = read_u64(p);
+        j = read_u64(p + 8);
+        k = read_u64(p + q - 8);
+    }
+
+    if (len >= 8 * 3) {
+        chixx(state[0], state[2], state[4]);
+        chixx(state[1], state[3], state[5]);
+        i ^= state[0] + state[1];
+        j ^= state[2] + state[3];
+        k ^= state[4] + state[5];
+    } else {
+        i ^= state[0];
+        j ^= state[1];
+        k ^= state[2];
+    }
+}
+
+constexpr void layer_f(bool bfast, std::size_t len, std::uint64_t& i, std::uint64_t& j, std::uint64_t& k) {
+    unsigned rot = static_cast<unsigned>(len & 63);
+    chixx(i, j, k);
+    i = rotl(i, rot);
+    j = rotr(j, rot);
+    k ^= static_cast<std::uint64_t>(len);
+
+    std::uint64_t lo0 = 0, lo1 = 0, lo2 = 0, hi0 = 0, hi1 = 0, hi2 = 0;
+    if (!bfast) {
+        wmul(lo0, hi0, i ^ SECRET[3], j);
+        wmul(lo1, hi1, j ^ SECRET[4], k);
+        wmul(lo2, hi2, k ^ SECRET[5], i);
+        i ^= lo0 ^ hi2;
+        j ^= lo1 ^ hi0;
+        k ^= lo2 ^ hi1;
+    } else {
+        wmul(lo0, hi0, i, j);
+        wmul(lo1, hi1, j, k);
+        wmul(lo2, hi2, k, i);
+        i = lo0 ^ hi2;
+        j = lo1 ^ hi0;
+        k = lo2 ^ hi1;
+    }
+}
+
+constexpr std::uint64_t hash_loong(bool bfast, const char* bytes, std::size_t len, std::uint64_t seed) {
+    const char* p = bytes;
+    std::size_t q = len;
+    std::uint64_t state[6] = {SECRET[0] + seed, SECRET[1] - seed, SECRET[2] ^ seed, SECRET[3], SECRET[4], SECRET[5]};
+
+    if (q >= 8 * 12) {
+        state[3] += seed;
+        state[4] -= seed;
+        state[5] ^= seed;
+        std::uint64_t ring_prev = RING_PREV;
+        do {
+            layer_12(bfast, state, p, ring_prev);
+            p += 8 * 12;
+            q -= 8 * 12;
+        } while (q >= 8 * 12);
+        state[0] ^= ring_prev;
+    }
+    if (q >= 8 * 6) {
+        frac_6(bfast, state[0], state[1], read_u64(p + 8 * 0), read_u64(p + 8 * 1));
+        frac_6(bfast, state[2], state[3], read_u64(p + 8 * 2), read_u64(p + 8 * 3));
+        frac_6(bfast, state[4], state[5], read_u64(p + 8 * 4), read_u64(p + 8 * 5));
+        p += 8 * 6;
+        q -= 8 * 6;
+    }
+    if (q >= 8 * 3) {
+        frac_3(bfast, state[0], state[3], read_u64(p + 8 * 0));
+        frac_3(bfast, state[1], state[4], read_u64(p + 8 * 1));
+        frac_3(bfast, state[2], state[5], read_u64(p + 8 * 2));
+        p += 8 * 3;
+        q -= 8 * 3;
+    }
+
+    std::uint64_t i = 0, j = 0, k = 0;
+    layer_0(state, p, q, len, i, j, k);
+    layer_f(bfast, len, i, j, k);
+
+    std::uint64_t lo0 = 0, lo1 = 0, lo2 = 0, hi0 = 0, hi1 = 0, hi2 = 0;
+    if (!bfast) {
+        wmul(lo0, hi0, i ^ SECRET[0], j);
+        wmul(lo1, hi1, j ^ SECRET[1], k);
+        wmul(lo2, hi2, k ^ SECRET[2], i);
+        i ^= lo0 ^ hi2;
+        j ^= lo1 ^ hi0;
+        k ^= lo2 ^ hi1;
+    } else {
+        wmul(lo0, hi0, i, j);
+        wmul(lo1, hi1, j, k);
+        wmul(lo2, hi2, k, i);
+        i = lo0 ^ hi2;
+        j = lo1 ^ hi0;
+        k = lo2 ^ hi1;
+    }
+    return i + j + k;
+}
+
+constexpr std::uint64_t hash_short(const char* bytes, std::size_t len, std::uint64_t seed) {
+    std::uint64_t i = 0, j = 0, lo = 0, hi = 0;
+    read_short(bytes, len, i, j);
+    wmul(lo, hi, seed ^ SECRET[0], len ^ SECRET[1]);
+    i ^= lo ^ len;
+    j ^= hi ^ seed;
+
+    i ^= SECRET[2];
+    j ^= SECRET[3];
+    wmul(lo, hi, i, j);
+    i ^= lo ^ SECRET[4];
+    j ^= hi ^ SECRET[5];
+    wmul(lo, hi, i, j);
+    return i ^ j ^ lo ^ hi;
+}
+
+constexpr std::uint64_t hash(bool bfast, std::string_view s, std::uint64_t seed) {
+    std::uint64_t i = s.size() <= 16 ? hash_short(s.data(), s.size(), seed)
+                                     : hash_loong(bfast, s.data(), s.size(), seed);
+#if MUSEAIR_BSWAP > 0
+    i = bswap_64(i);
+#endif
+    return i;
+}
+
+}  // namespace constexpr_detail
+
+// Same as `museair_hash(s.data(), s.size(), seed)`, usable in constant expressions.
+constexpr std::uint64_t constexpr_hash(std::string_view s, std::uint64_t seed = 0) {
+    return constexpr_detail::hash(false, s, seed);
+}
+// Same as `museair_bfast_hash(s.data(), s.size(), seed)`, usable in constant expressions.
+constexpr std::uint64_t constexpr_bfast_hash(std::string_view s, std::uint64_t seed = 0) {
+    return constexpr_detail::hash(true, s, seed);
+}
+
+namespace literals {
+
+// `"GET"_museair == museair_hash("GET", 3, 0)`, always evaluated at compile time since C++20.
+MUSEAIR_CONSTEVAL std::uint64_t operator""_museair(const char* s, std::size_t len) {
+    return constexpr_hash(std::string_view(s, len));
+}
+
+}  // namespace literals
+
+}  // namespace museair
+
+// Specializes `std::hash` for a user-defined type by hashing its object representation with MuseAir.
+// Must be used at global scope.
+#define MUSEAIR_SPECIALIZE_STD_HASH(T)                                                                      \
+    namespace std {                                                                                          \
+    template <>                                                                                              \
+    struct hash<T> {                                                                                         \
+        static_assert(::museair::is_bytewise_hashable_v<T>, "T must not have padding or float members");    \
+        std::size_t operator()(const T& v) const noexcept { return ::museair::hasher()(&v, sizeof(T)); }     \
+    };                                                                                                       \
+    }
+
+#endif  // MUSEAIR_HPP
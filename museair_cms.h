@@ -0,0 +1,435 @@
+/*
+ * Count-Min sketch with top-K tracking over MuseAir digests.
+ *
+ * SPDX-License-Identifier: Apache-2.0 OR MIT
+ *
+ * A sketch of `depth` rows of `width` counters overestimates the count of a key by at most `e / width` times the
+ * total count, except with probability `e^-depth`. Each key is hashed once with `museair_hash_128(key, len, seed)`,
+ * row `r` uses the counter picked by `lower + r * upper` (Kirsch-Mitzenmacher double hashing) scaled to `width`.
+ *
+ * Counters are 8, 16 or 32 bits wide and saturate instead of wrapping. With conservative update, a key only raises
+ * the counters that are below its new estimate, which tightens estimates a lot on skewed streams. Sketches of the
+ * same shape and seed merge by adding counters, so per-thread sketches can be combined, the result is a valid
+ * upper bound in both modes.
+ *
+ * With `k > 0`, the `k` keys of highest estimate seen so far are kept in a min-heap, each with its digest and the
+ * first `MUSEAIR_CMS_KEY` bytes of the key. A key enters when its estimate after an update exceeds the heap's
+ * minimum, as in the usual Count-Min heavy hitters scheme, and from then on counts its occurrences exactly, so heavy
+ * keys keep their rank after narrow counters saturate.
+ *
+ * The sketch is not thread-safe, use one per thread and merge.
+ */
+
+#ifndef MUSEAIR_CMS_H
+#define MUSEAIR_CMS_H
+
+#include "museair.h"
+
+#include <stdlib.h>
+
+#define MUSEAIR_CMS_KEY 32
+#define MUSEAIR_CMS_MAX_DEPTH 16
+#define MUSEAIR_CMS_BATCH 16  // keys whose counters are all in flight before the first update of a batch.
+
+typedef struct {
+    uint64_t count;
+    uint64_t lo, hi;  // digest of the key.
+    uint32_t len;     // of the whole key, `key` holds at most `MUSEAIR_CMS_KEY` bytes of it.
+    uint32_t slot;    // in `index`.
+    uint8_t key[MUSEAIR_CMS_KEY];
+} museair_cms_entry_t;
+
+typedef struct {
+    uint8_t bits;  // 8, 16 or 32.
+    bool conservative;
+    uint32_t depth;
+    uint64_t width;
+    uint64_t seed;
+    uint64_t total;  // sum of all added counts.
+    void* counters;  // `depth` rows of `width` counters.
+
+    uint32_t k, top_len;
+    museair_cms_entry_t* top;  // min-heap by count.
+    uint32_t* index;           // open addressing on `lo`, heap position + 1 or 0 for an empty slot.
+    uint32_t index_mask;
+} museair_cms_t;
+
+/*----------------------------------------------------------------------------*/
+
+static FORCE_INLINE uint64_t _museair_cms_column(const museair_cms_t* s, uint64_t lo, uint64_t hi, uint32_t row) {
+    uint64_t column, unused;
+    _museair_wmul(&unused, &column, lo + row * hi, s->width);
+    return column;
+}
+
+static FORCE_INLINE uint64_t _museair_cms_get(const int Bits, const void* counters, uint64_t i) {
+    return Bits == 8 ? ((const uint8_t*)counters)[i] : Bits == 16 ? ((const uint16_t*)counters)[i]
+                                                                   : ((const uint32_t*)counters)[i];
+}
+
+static FORCE_INLINE void _museair_cms_set(const int Bits, void* counters, uint64_t i, uint64_t v) {
+    const uint64_t max = Bits == 32 ? UINT32_MAX : (UINT64_C(1) << Bits) - 1;
+    v = v < max ? v : max;
+    if (Bits == 8) {
+        ((uint8_t*)counters)[i] = (uint8_t)v;
+    } else if (Bits == 16) {
+        ((uint16_t*)counters)[i] = (uint16_t)v;
+    } else {
+        ((uint32_t*)counters)[i] = (uint32_t)v;
+    }
+}
+
+static FORCE_INLINE uint64_t _museair_cms_max(const museair_cms_t* s) {
+    return s->bits == 32 ? UINT32_MAX : (UINT64_C(1) << s->bits) - 1;
+}
+
+// Counters of a digest, one per row.
+static FORCE_INLINE void _museair_cms_positions(const museair_cms_t* s, uint64_t lo, uint64_t hi, uint64_t* at) {
+    for (uint32_t r = 0; r < s->depth; r++) {
+        at[r] = r * s->width + _museair_cms_column(s, lo, hi, r);
+    }
+}
+
+// Adds `count` to the counters `at[depth]` of a key, returns its new estimate.
+static FORCE_INLINE uint64_t _museair_cms_update(const int Bits, museair_cms_t* s, const uint64_t* at, uint64_t count) {
+    uint64_t estimate = UINT64_MAX;
+    for (uint32_t r = 0; r < s->depth; r++) {
+        uint64_t c = _museair_cms_get(Bits, s->counters, at[r]);
+        estimate = c < estimate ? c : estimate;
+    }
+    if (s->conservative) {
+        estimate += count;
+        for (uint32_t r = 0; r < s->depth; r++) {
+            if (_museair_cms_get(Bits, s->counters, at[r]) < estimate) {
+                _museair_cms_set(Bits, s->counters, at[r], estimate);
+            }
+        }
+    } else {
+        estimate = UINT64_MAX;
+        for (uint32_t r = 0; r < s->depth; r++) {
+            _museair_cms_set(Bits, s->counters, at[r], _museair_cms_get(Bits, s->counters, at[r]) + count);
+            uint64_t c = _museair_cms_get(Bits, s->counters, at[r]);
+            estimate = c < estimate ? c : estimate;
+        }
+    }
+    return estimate < _museair_cms_max(s) ? estimate : _museair_cms_max(s);
+}
+
+static FORCE_INLINE uint64_t _museair_cms_query(const int Bits, const museair_cms_t* s, uint64_t lo, uint64_t hi) {
+    uint64_t estimate = UINT64_MAX;
+    for (uint32_t r = 0; r < s->depth; r++) {
+        uint64_t c = _museair_cms_get(Bits, s->counters, r * s->width + _museair_cms_column(s, lo, hi, r));
+        estimate = c < estimate ? c : estimate;
+    }
+    return estimate;
+}
+
+static inline uint64_t _museair_cms_query_digest(const museair_cms_t* s, uint64_t lo, uint64_t hi) {
+    switch (s->bits) {
+        case 8:
+            return _museair_cms_query(8, s, lo, hi);
+        case 16:
+            return _museair_cms_query(16, s, lo, hi);
+        default:
+            return _museair_cms_query(32, s, lo, hi);
+    }
+}
+
+static inline uint64_t _museair_cms_add_digest(museair_cms_t* s, uint64_t lo, uint64_t hi, uint64_t count) {
+    uint64_t at[MUSEAIR_CMS_MAX_DEPTH];
+    _museair_cms_positions(s, lo, hi, at);
+    s->total += count;
+    switch (s->bits) {
+        case 8:
+            return _museair_cms_update(8, s, at, count);
+        case 16:
+            return _museair_cms_update(16, s, at, count);
+        default:
+            return _museair_cms_update(32, s, at, count);
+    }
+}
+
+/*----------------------------------------------------------------------------*/
+
+static FORCE_INLINE void _museair_cms_swap(museair_cms_t* s, uint32_t a, uint32_t b) {
+    museair_cms_entry_t t = s->top[a];
+    s->top[a] = s->top[b];
+    s->top[b] = t;
+    s->index[s->top[a].slot] = a + 1;
+    s->index[s->top[b].slot] = b + 1;
+}
+
+static inline void _museair_cms_sift_down(museair_cms_t* s, uint32_t i) {
+    for (;;) {
+        uint32_t least = i, l = 2 * i + 1, r = 2 * i + 2;
+        if (l < s->top_len && s->top[l].count < s->top[least].count) {
+            least = l;
+        }
+        if (r < s->top_len && s->top[r].count < s->top[least].count) {
+            least = r;
+        }
+        if (least == i) {
+            return;
+        }
+        _museair_cms_swap(s, i, least);
+        i = least;
+    }
+}
+
+static inline void _museair_cms_sift_up(museair_cms_t* s, uint32_t i) {
+    while (i > 0 && s->top[(i - 1) / 2].count > s->top[i].count) {
+        _museair_cms_swap(s, i, (i - 1) / 2);
+        i = (i - 1) / 2;
+    }
+}
+
+// Slot of the digest in `index`, or of the empty slot ending its probe sequence.
+static inline uint32_t _museair_cms_find(const museair_cms_t* s, uint64_t lo, uint64_t hi) {
+    for (uint32_t slot = (uint32_t)lo & s->index_mask;; slot = (slot + 1) & s->index_mask) {
+        uint32_t at = s->index[slot];
+        if (at == 0 || (s->top[at - 1].lo == lo && s->top[at - 1].hi == hi)) {
+            return slot;
+        }
+    }
+}
+
+// Empties `slot` with backward shift deletion, so that no probe sequence is cut short.
+static inline void _museair_cms_unindex(museair_cms_t* s, uint32_t slot) {
+    for (uint32_t next = (slot + 1) & s->index_mask; s->index[next] != 0; next = (next + 1) & s->index_mask) {
+        uint32_t home = (uint32_t)s->top[s->index[next] - 1].lo & s->index_mask;
+        if (((next - home) & s->index_mask) >= ((next - slot) & s->index_mask)) {
+            s->index[slot] = s->index[next];
+            s->top[s->index[slot] - 1].slot = slot;
+            slot = next;
+        }
+    }
+    s->index[slot] = 0;
+}
+
+// Ranks a key after `count` more occurrences brought its estimate to `estimate`. A tracked key counts them exactly
+// instead, which is the same while counters do not saturate, since it entered at its estimate.
+static inline void _museair_cms_track(museair_cms_t* s,
+                                      uint64_t lo,
+                                      uint64_t hi,
+                                      const void* key,
+                                      size_t len,
+                                      uint64_t count,
+                                      uint64_t estimate) {
+    // An unsaturated estimate not above the minimum is not a tracked key's, those are raised by `count` at least.
+    if (s->k == 0 || (s->top_len == s->k && estimate <= s->top[0].count && estimate < _museair_cms_max(s))) {
+        return;
+    }
+    uint32_t slot = _museair_cms_find(s, lo, hi);
+    if (s->index[slot] != 0) {
+        uint32_t at = s->index[slot] - 1;
+        s->top[at].count += count;
+        _museair_cms_sift_down(s, at);
+        return;
+    }
+    if (s->top_len == s->k && estimate <= s->top[0].count) {
+        return;
+    }
+    uint32_t at;
+    if (s->top_len == s->k) {
+        at = 0;  // replaces the minimum.
+        _museair_cms_unindex(s, s->top[0].slot);
+        slot = _museair_cms_find(s, lo, hi);
+    } else {
+        at = s->top_len++;
+    }
+    museair_cms_entry_t* e = &s->top[at];
+    e->count = estimate > count ? estimate : count;  // a saturated estimate may be below this update alone.
+    e->lo = lo;
+    e->hi = hi;
+    e->len = (uint32_t)len;
+    e->slot = slot;
+    memcpy(e->key, key, len < MUSEAIR_CMS_KEY ? len : MUSEAIR_CMS_KEY);
+    s->index[slot] = at + 1;
+    if (at == 0) {
+        _museair_cms_sift_down(s, 0);
+    } else {
+        _museair_cms_sift_up(s, at);
+    }
+}
+
+// `dst[i] = min(dst[i] + src[i], max)` for `n` counters of the same width.
+static inline void _museair_cms_add_counters(const int bits, void* dst, const void* src, size_t n) {
+    size_t i = 0;
+#if defined(__SSE2__) || defined(_M_X64)
+    const size_t lanes = 128 / (size_t)bits;
+    if (bits != 32) {
+        for (; i + lanes <= n; i += lanes) {
+            __m128i* d = (__m128i*)dst + i / lanes;
+            __m128i a = _mm_loadu_si128(d), b = _mm_loadu_si128((const __m128i*)src + i / lanes);
+            _mm_storeu_si128(d, bits == 8 ? _mm_adds_epu8(a, b) : _mm_adds_epu16(a, b));
+        }
+    }
+#endif
+    for (; i < n; i++) {
+        if (bits == 8) {
+            _museair_cms_set(8, dst, i, _museair_cms_get(8, dst, i) + _museair_cms_get(8, src, i));
+        } else if (bits == 16) {
+            _museair_cms_set(16, dst, i, _museair_cms_get(16, dst, i) + _museair_cms_get(16, src, i));
+        } else {
+            _museair_cms_set(32, dst, i, _museair_cms_get(32, dst, i) + _museair_cms_get(32, src, i));
+        }
+    }
+}
+
+static int _museair_cms_by_count(const void* a, const void* b) {
+    uint64_t x = ((const museair_cms_entry_t*)a)->count, y = ((const museair_cms_entry_t*)b)->count;
+    return (x < y) - (x > y);
+}
+
+/*----------------------------------------------------------------------------*/
+
+// Creates an empty sketch of `depth` (1 to `MUSEAIR_CMS_MAX_DEPTH`) rows of `width` counters of `bits` (8, 16 or
+// 32) bits, tracking the `k` heaviest keys. Returns false on invalid arguments or if out of memory.
+static inline bool museair_cms_init(museair_cms_t* s,
+                                    const uint64_t width,
+                                    const uint32_t depth,
+                                    const int bits,
+                                    const bool conservative,
+                                    const uint32_t k,
+                                    const uint64_t seed) {
+    memset(s, 0, sizeof(*s));
+    if (width == 0 || depth == 0 || depth > MUSEAIR_CMS_MAX_DEPTH || (bits != 8 && bits != 16 && bits != 32)) {
+        return false;
+    }
+    s->bits = (uint8_t)bits;
+    s->conservative = conservative;
+    s->depth = depth;
+    s->width = width;
+    s->seed = seed;
+    s->k = k;
+    s->index_mask = 1;
+    while (s->index_mask < 2 * k) {
+        s->index_mask *= 2;
+    }
+    s->index_mask--;
+    s->counters = calloc((size_t)(width * depth), (size_t)bits / 8);
+    s->top = (museair_cms_entry_t*)calloc(k ? k : 1, sizeof(museair_cms_entry_t));
+    s->index = (uint32_t*)calloc((size_t)s->index_mask + 1, sizeof(uint32_t));
+    if (s->counters == NULL || s->top == NULL || s->index == NULL) {
+        free(s->counters), free(s->top), free(s->index);
+        memset(s, 0, sizeof(*s));
+        return false;
+    }
+    return true;
+}
+
+static inline void museair_cms_free(museair_cms_t* s) {
+    free(s->counters);
+    free(s->top);
+    free(s->index);
+    s->counters = NULL;
+    s->top = NULL;
+    s->index = NULL;
+}
+
+// Adds `count` occurrences of `key`, returns its new estimate.
+static inline uint64_t museair_cms_add(museair_cms_t* s, const void* key, const size_t len, const uint64_t count) {
+    uint64_t hi, lo = museair_hash_128(key, len, s->seed, &hi);
+    uint64_t estimate = _museair_cms_add_digest(s, lo, hi, count);
+    _museair_cms_track(s, lo, hi, key, len, count, estimate);
+    return estimate;
+}
+
+// Estimated count of `key`, never below its true count unless counters saturated.
+static inline uint64_t museair_cms_estimate(const museair_cms_t* s, const void* key, const size_t len) {
+    uint64_t hi, lo = museair_hash_128(key, len, s->seed, &hi);
+    return _museair_cms_query_digest(s, lo, hi);
+}
+
+static FORCE_INLINE void _museair_cms_add_batch(const int Bits,
+                                                museair_cms_t* s,
+                                                const void* const* keys,
+                                                const size_t* lens,
+                                                const uint64_t* counts,
+                                                const size_t n) {
+    uint64_t digests[2 * MUSEAIR_CMS_BATCH], at[MUSEAIR_CMS_BATCH][MUSEAIR_CMS_MAX_DEPTH];
+    for (size_t b = 0; b < n; b += MUSEAIR_CMS_BATCH) {
+        const size_t m = n - b < MUSEAIR_CMS_BATCH ? n - b : MUSEAIR_CMS_BATCH;
+        _museair_hash_batch(false, true, keys + b, lens + b, m, s->seed, digests);
+        for (size_t l = 0; l < m; l++) {
+            _museair_cms_positions(s, digests[2 * l], digests[2 * l + 1], at[l]);
+            for (uint32_t r = 0; r < s->depth; r++) {
+                _museair_prefetch((const uint8_t*)s->counters + at[l][r] * (Bits / 8), 1);
+            }
+        }
+        for (size_t l = 0; l < m; l++) {
+            uint64_t count = counts ? counts[b + l] : 1;
+            s->total += count;
+            _museair_cms_track(s, digests[2 * l], digests[2 * l + 1], keys[b + l], lens[b + l], count,
+                               _museair_cms_update(Bits, s, at[l], count));
+        }
+    }
+}
+
+// Same as `museair_cms_add` for each key, with `counts[n]` occurrences or one each if `counts` is NULL.
+static inline void museair_cms_add_batch(museair_cms_t* s,
+                                         const void* const* keys,
+                                         const size_t* lens,
+                                         const uint64_t* counts,
+                                         const size_t n) {
+    switch (s->bits) {
+        case 8:
+            _museair_cms_add_batch(8, s, keys, lens, counts, n);
+            break;
+        case 16:
+            _museair_cms_add_batch(16, s, keys, lens, counts, n);
+            break;
+        default:
+            _museair_cms_add_batch(32, s, keys, lens, counts, n);
+            break;
+    }
+}
+
+// Adds the counts of `src` to `dst`, and re-ranks their heavy keys. Returns false if their shapes, counter widths
+// or seeds differ.
+static inline bool museair_cms_merge(museair_cms_t* dst, const museair_cms_t* src) {
+    if (dst->width != src->width || dst->depth != src->depth || dst->bits != src->bits || dst->seed != src->seed) {
+        return false;
+    }
+
+    // A heavy key of one sketch gains its count in the other, tracked there or estimated from the counters.
+    museair_cms_entry_t* candidates =
+        (museair_cms_entry_t*)malloc(((size_t)dst->top_len + src->top_len + 1) * sizeof(museair_cms_entry_t));
+    uint32_t n = 0;
+    for (uint32_t i = 0; candidates != NULL && i < dst->top_len; i++) {
+        const museair_cms_entry_t* e = &dst->top[i];
+        uint32_t at = src->k ? src->index[_museair_cms_find(src, e->lo, e->hi)] : 0;
+        candidates[n] = *e;
+        candidates[n++].count += at ? src->top[at - 1].count : _museair_cms_query_digest(src, e->lo, e->hi);
+    }
+    for (uint32_t i = 0; candidates != NULL && i < src->top_len; i++) {
+        const museair_cms_entry_t* e = &src->top[i];
+        if (dst->index[_museair_cms_find(dst, e->lo, e->hi)] == 0) {
+            candidates[n] = *e;
+            candidates[n++].count += _museair_cms_query_digest(dst, e->lo, e->hi);
+        }
+    }
+
+    _museair_cms_add_counters(dst->bits, dst->counters, src->counters, (size_t)(dst->width * dst->depth));
+    dst->total += src->total;
+    if (candidates == NULL) {
+        return true;  // out of memory, the heavy keys of `dst` are kept with stale counts.
+    }
+    dst->top_len = 0;
+    memset(dst->index, 0, ((size_t)dst->index_mask + 1) * sizeof(uint32_t));
+    for (uint32_t i = 0; i < n; i++) {
+        const museair_cms_entry_t* c = &candidates[i];
+        _museair_cms_track(dst, c->lo, c->hi, c->key, c->len, 0, c->count);
+    }
+    free(candidates);
+    return true;
+}
+
+// Copies the tracked heavy keys to `out[k]`, highest estimate first, and returns their number.
+static inline uint32_t museair_cms_top(const museair_cms_t* s, museair_cms_entry_t* out) {
+    memcpy(out, s->top, (size_t)s->top_len * sizeof(museair_cms_entry_t));
+    qsort(out, s->top_len, sizeof(museair_cms_entry_t), _museair_cms_by_count);
+    return s->top_len;
+}
+
+#endif  // MUSEAIR_CMS_H
@@ -0,0 +1,209 @@
+/*
+ * Concurrent hash map keyed by MuseAir 128-bit digests, for deduplication shared by many threads. Requires C++17.
+ *
+ * SPDX-License-Identifier: Apache-2.0 OR MIT
+ *
+ *     museair::concurrent_digest_map seen(1 << 20);
+ *     if (seen.insert(chunk, chunk_len, offset).second) { ... first occurrence ... }
+ *
+ * Keys are identified by their `museair_hash_128` digest alone: two inputs with the same digest are the same key.
+ * A digest selects one of a power of two shards by its upper half and a slot of that shard by its lower half.
+ * Each shard is a linear probing table of (digest, value) slots:
+ *
+ *   - `find` never locks. A slot is published by a release store of the lower half of its digest, written after
+ *     the rest of the slot, so readers see complete entries or none.
+ *   - `insert` looks the digest up without locking first, so duplicates are cheap, and only takes the lock of its
+ *     shard to add an entry.
+ *   - A shard that reaches half load is doubled under its own lock, the other shards are not paused. Readers
+ *     still probing the previous table find every entry published before the switch, so tables are retired and
+ *     freed with the map instead of being reclaimed while in use, which at most doubles the footprint.
+ *
+ * Entries cannot be removed, values are set by the first insert of a key.
+ */
+
+#ifndef MUSEAIR_CONCURRENT_MAP_HPP
+#define MUSEAIR_CONCURRENT_MAP_HPP
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "museair.h"
+
+namespace museair {
+
+struct digest128 {
+    std::uint64_t lo, hi;
+};
+
+class concurrent_digest_map {
+   public:
+    // `expected` entries fit without growing. `shards` is rounded up to a power of two, 0 picks 64 per hardware
+    // thread so that writers rarely meet on a lock.
+    explicit concurrent_digest_map(std::size_t expected = 0, std::uint64_t seed = 0, std::size_t shards = 0)
+        : seed_(seed) {
+        if (shards == 0) {
+            shards = 64 * std::max(1u, std::thread::hardware_concurrency());
+        }
+        while ((std::size_t(1) << shard_bits_) < shards) {
+            shard_bits_++;
+        }
+        shards_.reset(new shard[std::size_t(1) << shard_bits_]);
+        std::size_t per_shard = expected >> shard_bits_;
+        for (std::size_t n = 0; n < (std::size_t(1) << shard_bits_); n++) {
+            shards_[n].install(table::create(capacity_for(per_shard + 1)));
+        }
+    }
+    concurrent_digest_map(const concurrent_digest_map&) = delete;
+    concurrent_digest_map& operator=(const concurrent_digest_map&) = delete;
+
+    digest128 hash(const void* key, std::size_t len) const {
+        digest128 d;
+        d.lo = museair_hash_128(key, len, seed_, &d.hi);
+        return d;
+    }
+
+    // Adds `key` with `value` if absent. Returns the value stored for `key` and whether it was inserted.
+    std::pair<std::uint64_t, bool> insert(const void* key, std::size_t len, std::uint64_t value) {
+        return insert(hash(key, len), value);
+    }
+    std::pair<std::uint64_t, bool> insert(digest128 d, std::uint64_t value) {
+        d.lo = normalize(d.lo);
+        shard& s = shard_of(d);
+        std::uint64_t found;
+        if (s.current.load(std::memory_order_acquire)->find(d, &found)) {
+            return {found, false};
+        }
+
+        std::lock_guard<std::mutex> guard(s.lock);
+        table* t = s.current.load(std::memory_order_relaxed);
+        std::uint64_t seen;
+        std::size_t n = t->probe(d, &seen);
+        if (seen != 0) {
+            return {t->slots[n].value, false};  // inserted since the lock-free lookup.
+        }
+        if (2 * (s.count.load(std::memory_order_relaxed) + 1) > t->mask + 1) {
+            t = s.grow();
+            n = t->probe(d, &seen);
+        }
+        t->publish(n, d, value);
+        s.count.store(s.count.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+        return {value, true};
+    }
+
+    // Returns whether `key` is present, and its value in `*value` if so.
+    bool find(const void* key, std::size_t len, std::uint64_t* value) const { return find(hash(key, len), value); }
+    bool find(digest128 d, std::uint64_t* value) const {
+        d.lo = normalize(d.lo);
+        return shard_of(d).current.load(std::memory_order_acquire)->find(d, value);
+    }
+
+    // Entries inserted so far, exact once concurrent inserts have returned.
+    std::size_t size() const {
+        std::size_t n = 0;
+        for (std::size_t s = 0; s < (std::size_t(1) << shard_bits_); s++) {
+            n += shards_[s].count.load(std::memory_order_relaxed);
+        }
+        return n;
+    }
+
+   private:
+    struct slot {
+        std::atomic<std::uint64_t> lo{0};  // 0 for an empty slot, published last.
+        std::uint64_t hi = 0;
+        std::uint64_t value = 0;
+    };
+
+    struct table {
+        std::size_t mask;
+        std::unique_ptr<slot[]> slots;
+
+        static table* create(std::size_t capacity) {
+            table* t = new table;
+            t->mask = capacity - 1;
+            t->slots.reset(new slot[capacity]);
+            return t;
+        }
+
+        // Slot holding `d`, or the empty slot ending its probe sequence. `*seen` is the `lo` the probe read there,
+        // the slot may have been published since and must not be loaded again.
+        std::size_t probe(digest128 d, std::uint64_t* seen) const {
+            for (std::size_t n = d.lo & mask;; n = (n + 1) & mask) {
+                *seen = slots[n].lo.load(std::memory_order_acquire);
+                if (*seen == 0 || (*seen == d.lo && slots[n].hi == d.hi)) {
+                    return n;
+                }
+            }
+        }
+
+        bool find(digest128 d, std::uint64_t* value) const {
+            std::uint64_t seen;
+            const slot& s = slots[probe(d, &seen)];
+            if (seen == 0) {
+                return false;
+            }
+            *value = s.value;
+            return true;
+        }
+
+        void publish(std::size_t n, digest128 d, std::uint64_t value) {
+            slots[n].hi = d.hi;
+            slots[n].value = value;
+            slots[n].lo.store(d.lo, std::memory_order_release);
+        }
+    };
+
+    struct alignas(64) shard {
+        std::atomic<table*> current{nullptr};
+        std::atomic<std::size_t> count{0};
+        std::mutex lock;
+        std::vector<std::unique_ptr<table>> tables;  // current one last, previous ones may still be read.
+
+        void install(table* t) {
+            tables.emplace_back(t);
+            current.store(t, std::memory_order_release);
+        }
+
+        // Called with `lock` held, readers keep probing the old table meanwhile.
+        table* grow() {
+            const table* old = current.load(std::memory_order_relaxed);
+            table* t = table::create(2 * (old->mask + 1));
+            for (std::size_t n = 0; n <= old->mask; n++) {
+                const slot& s = old->slots[n];
+                std::uint64_t lo = s.lo.load(std::memory_order_relaxed);
+                if (lo != 0) {
+                    digest128 d = {lo, s.hi};
+                    t->publish(t->probe(d, &lo), d, s.value);
+                }
+            }
+            install(t);
+            return t;
+        }
+    };
+
+    static std::uint64_t normalize(std::uint64_t lo) { return lo ? lo : 1; }  // 0 marks empty slots.
+
+    static std::size_t capacity_for(std::size_t n) {
+        std::size_t c = 16;
+        while (c < 2 * n) {
+            c *= 2;
+        }
+        return c;
+    }
+
+    shard& shard_of(digest128 d) const { return shards_[shard_bits_ ? d.hi >> (64 - shard_bits_) : 0]; }
+
+    std::uint64_t seed_;
+    unsigned shard_bits_ = 0;
+    std::unique_ptr<shard[]> shards_;
+};
+
+}  // namespace museair
+
+#endif  // MUSEAIR_CONCURRENT_MAP_HPP
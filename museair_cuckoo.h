@@ -0,0 +1,298 @@
+/*
+ * Cuckoo filter over MuseAir digests, an approximate set that supports deletes.
+ *
+ * SPDX-License-Identifier: Apache-2.0 OR MIT
+ *
+ * Follows "Cuckoo Filter: Practically Better Than Bloom" (Fan et al., 2014) with buckets of four 16-bit
+ * fingerprints, each bucket one 64-bit word searched with a few word operations. A key is hashed once with
+ * `museair_bfast_hash_128(key, len, seed)`: the lower half picks its first bucket and the upper half gives its
+ * fingerprint, the second bucket being a hash of the fingerprint minus the first, modulo the bucket count (which
+ * needs not be a power of two). Filters fill to about 95% before inserts start failing. Sized for a load of 90%,
+ * that is about 18 bits per key, the false positive rate is about 0.01%.
+ *
+ * Deleting a key that was never inserted may delete another key of the same fingerprint and buckets, as in any
+ * cuckoo filter. A key may be inserted several times and must then be deleted as many times, up to 8 copies.
+ *
+ * Next to `MUSEAIR_CUCKOO_MAGIC`, an image records the bucket count, seed, key count and victim; the buckets follow.
+ * Inserts and deletes on a loaded filter write to its buckets but not to its header, save it again to keep the count.
+ *
+ * The filter is not thread-safe for inserts and deletes, concurrent queries are fine.
+ */
+
+#ifndef MUSEAIR_CUCKOO_H
+#define MUSEAIR_CUCKOO_H
+
+#include "museair.h"
+
+#include <stdlib.h>
+
+#define MUSEAIR_CUCKOO_MAGIC "MuseCkf1"
+#define MUSEAIR_CUCKOO_HEADER 64
+#define MUSEAIR_CUCKOO_BATCH 16  // keys per round of the batch functions, both buckets of each are prefetched.
+#define MUSEAIR_CUCKOO_KICKS 500
+
+typedef struct {
+    uint64_t* buckets;  // `nbuckets` words of four fingerprints, 0 for an empty slot.
+    uint64_t nbuckets;
+    uint64_t seed;
+    uint64_t count;
+    uint64_t victim;  // a fingerprint that found no place and its bucket, `fingerprint << 48 | bucket`, or 0.
+    uint64_t rng;
+    void* mem;  // allocation behind `buckets`, NULL for a loaded image.
+} museair_cuckoo_t;
+
+/*----------------------------------------------------------------------------*/
+
+#define _MUSEAIR_CUCKOO_LOWS UINT64_C(0x0001000100010001)
+#define _MUSEAIR_CUCKOO_HIGHS UINT64_C(0x8000800080008000)
+#define _MUSEAIR_CUCKOO_AT UINT64_C(0xffffffffffff)
+
+static FORCE_INLINE uint64_t _museair_cuckoo_fingerprint(uint64_t hi) {
+    uint64_t fp = hi & 0xffff;
+    return fp + (fp == 0);
+}
+
+static FORCE_INLINE uint64_t _museair_cuckoo_bucket(const museair_cuckoo_t* f, uint64_t lo) {
+    uint64_t bucket, unused;
+    _museair_wmul(&unused, &bucket, lo, f->nbuckets);
+    return bucket;
+}
+
+// `h(fp) - bucket` modulo the bucket count, so that the alternate of the alternate is the bucket again without
+// needing a power of two buckets.
+static FORCE_INLINE uint64_t _museair_cuckoo_alt(const museair_cuckoo_t* f, uint64_t bucket, uint64_t fp) {
+    const uint64_t h = _museair_cuckoo_bucket(f, fp * UINT64_C(0x9E3779B97F4A7C15));
+    return h >= bucket ? h - bucket : h + f->nbuckets - bucket;
+}
+
+// Non-zero if any 16-bit lane of `word` is zero.
+static FORCE_INLINE uint64_t _museair_cuckoo_has_zero(uint64_t word) {
+    return (word - _MUSEAIR_CUCKOO_LOWS) & ~word & _MUSEAIR_CUCKOO_HIGHS;
+}
+
+static FORCE_INLINE bool _museair_cuckoo_has(const museair_cuckoo_t* f, uint64_t bucket, uint64_t fp) {
+    return _museair_cuckoo_has_zero(_museair_native_u64(f->buckets[bucket]) ^ (fp * _MUSEAIR_CUCKOO_LOWS)) != 0;
+}
+
+// Puts `fp` in a free slot of `bucket`, returns false if there is none.
+static FORCE_INLINE bool _museair_cuckoo_put(museair_cuckoo_t* f, uint64_t bucket, uint64_t fp) {
+    const uint64_t word = _museair_native_u64(f->buckets[bucket]);
+    for (int s = 0; s < 64; s += 16) {
+        if (((word >> s) & 0xffff) == 0) {
+            f->buckets[bucket] = _museair_native_u64(word | fp << s);
+            return true;
+        }
+    }
+    return false;
+}
+
+// Clears one slot of `bucket` holding `fp`, returns false if there is none.
+static FORCE_INLINE bool _museair_cuckoo_take(museair_cuckoo_t* f, uint64_t bucket, uint64_t fp) {
+    const uint64_t word = _museair_native_u64(f->buckets[bucket]);
+    for (int s = 0; s < 64; s += 16) {
+        if (((word >> s) & 0xffff) == fp) {
+            f->buckets[bucket] = _museair_native_u64(word & ~(UINT64_C(0xffff) << s));
+            return true;
+        }
+    }
+    return false;
+}
+
+// Places `fp` in `bucket` or its alternate, moving other fingerprints out of the way. If it runs out of kicks, the
+// fingerprint left over becomes the victim.
+static inline bool _museair_cuckoo_place(museair_cuckoo_t* f, uint64_t bucket, uint64_t fp) {
+    if (f->victim) {
+        return false;
+    }
+    if (_museair_cuckoo_put(f, bucket, fp) || _museair_cuckoo_put(f, bucket = _museair_cuckoo_alt(f, bucket, fp), fp)) {
+        f->count++;
+        return true;
+    }
+    for (int kick = 0; kick < MUSEAIR_CUCKOO_KICKS; kick++) {
+        f->rng = f->rng * UINT64_C(6364136223846793005) + UINT64_C(1442695040888963407);
+        const int s = (int)(f->rng >> 62) * 16;
+        const uint64_t word = _museair_native_u64(f->buckets[bucket]);
+        const uint64_t out = (word >> s) & 0xffff;
+        f->buckets[bucket] = _museair_native_u64((word & ~(UINT64_C(0xffff) << s)) | fp << s);
+        fp = out;
+        bucket = _museair_cuckoo_alt(f, bucket, fp);
+        if (_museair_cuckoo_put(f, bucket, fp)) {
+            f->count++;
+            return true;
+        }
+    }
+    f->victim = fp << 48 | bucket;
+    f->count++;
+    return true;
+}
+
+static FORCE_INLINE bool _museair_cuckoo_victim_is(const museair_cuckoo_t* f, uint64_t bucket, uint64_t fp) {
+    const uint64_t at = f->victim & _MUSEAIR_CUCKOO_AT;
+    return f->victim >> 48 == fp && (at == bucket || at == _museair_cuckoo_alt(f, bucket, fp));
+}
+
+/*----------------------------------------------------------------------------*/
+
+// Buckets for `expected` keys at a load of 90%.
+static inline uint64_t museair_cuckoo_buckets_for(const uint64_t expected) {
+    uint64_t buckets = (expected * 10 + 35) / 36;
+    return buckets ? buckets : 1;
+}
+
+// Allocates an empty filter of `nbuckets` buckets (fewer than 2^48). Returns false if out of memory.
+static inline bool museair_cuckoo_init(museair_cuckoo_t* f, const uint64_t nbuckets, const uint64_t seed) {
+    memset(f, 0, sizeof(*f));
+    f->nbuckets = nbuckets ? nbuckets : 1;
+    f->seed = seed;
+    f->rng = seed;
+    f->mem = calloc((size_t)f->nbuckets * 8 + 63, 1);
+    f->buckets = (uint64_t*)(((uintptr_t)f->mem + 63) & ~(uintptr_t)63);
+    return f->mem != NULL;
+}
+
+// Frees the filter's buckets, a loaded image is left to its owner.
+static inline void museair_cuckoo_free(museair_cuckoo_t* f) {
+    free(f->mem);
+    f->mem = NULL;
+    f->buckets = NULL;
+}
+
+// On a digest `lo = museair_bfast_hash_128(key, len, f->seed, &hi)` the caller already has.
+static inline bool museair_cuckoo_insert_digest(museair_cuckoo_t* f, const uint64_t lo, const uint64_t hi) {
+    return _museair_cuckoo_place(f, _museair_cuckoo_bucket(f, lo), _museair_cuckoo_fingerprint(hi));
+}
+static inline bool museair_cuckoo_contains_digest(const museair_cuckoo_t* f, const uint64_t lo, const uint64_t hi) {
+    const uint64_t fp = _museair_cuckoo_fingerprint(hi), i1 = _museair_cuckoo_bucket(f, lo);
+    return _museair_cuckoo_has(f, i1, fp) || _museair_cuckoo_has(f, _museair_cuckoo_alt(f, i1, fp), fp) ||
+           (f->victim && _museair_cuckoo_victim_is(f, i1, fp));
+}
+static inline bool museair_cuckoo_delete_digest(museair_cuckoo_t* f, const uint64_t lo, const uint64_t hi) {
+    const uint64_t fp = _museair_cuckoo_fingerprint(hi), i1 = _museair_cuckoo_bucket(f, lo);
+    if (f->victim && _museair_cuckoo_victim_is(f, i1, fp)) {
+        f->victim = 0;
+        f->count--;
+        return true;
+    }
+    if (!_museair_cuckoo_take(f, i1, fp) && !_museair_cuckoo_take(f, _museair_cuckoo_alt(f, i1, fp), fp)) {
+        return false;
+    }
+    f->count--;
+    if (f->victim) {
+        // A place was freed, try the victim again.
+        const uint64_t victim = f->victim;
+        f->victim = 0;
+        f->count--;
+        _museair_cuckoo_place(f, victim & _MUSEAIR_CUCKOO_AT, victim >> 48);
+    }
+    return true;
+}
+
+// Returns false if the filter is full, then only deletes can make room again.
+static inline bool museair_cuckoo_insert(museair_cuckoo_t* f, const void* key, const size_t len) {
+    uint64_t hi, lo = museair_bfast_hash_128(key, len, f->seed, &hi);
+    return museair_cuckoo_insert_digest(f, lo, hi);
+}
+
+// Returns false if `key` is not in the filter, true if it probably is.
+static inline bool museair_cuckoo_contains(const museair_cuckoo_t* f, const void* key, const size_t len) {
+    uint64_t hi, lo = museair_bfast_hash_128(key, len, f->seed, &hi);
+    return museair_cuckoo_contains_digest(f, lo, hi);
+}
+
+// Deletes one copy of `key`, returns false if none was found.
+static inline bool museair_cuckoo_delete(museair_cuckoo_t* f, const void* key, const size_t len) {
+    uint64_t hi, lo = museair_bfast_hash_128(key, len, f->seed, &hi);
+    return museair_cuckoo_delete_digest(f, lo, hi);
+}
+
+// Same as `museair_cuckoo_insert` for each key. Returns the number of keys inserted, less than `n` if the filter
+// filled up.
+static inline size_t museair_cuckoo_insert_batch(museair_cuckoo_t* f,
+                                                 const void* const* keys,
+                                                 const size_t* lens,
+                                                 const size_t n) {
+    uint64_t digests[2 * MUSEAIR_CUCKOO_BATCH];
+    size_t inserted = 0;
+    for (size_t b = 0; b < n; b += MUSEAIR_CUCKOO_BATCH) {
+        const size_t m = n - b < MUSEAIR_CUCKOO_BATCH ? n - b : MUSEAIR_CUCKOO_BATCH;
+        _museair_hash_batch(true, true, keys + b, lens + b, m, f->seed, digests);
+        for (size_t l = 0; l < m; l++) {
+            const uint64_t i1 = _museair_cuckoo_bucket(f, digests[2 * l]);
+            const uint64_t i2 = _museair_cuckoo_alt(f, i1, _museair_cuckoo_fingerprint(digests[2 * l + 1]));
+            _museair_prefetch(&f->buckets[i1], 1);
+            _museair_prefetch(&f->buckets[i2], 1);
+        }
+        for (size_t l = 0; l < m; l++) {
+            inserted += museair_cuckoo_insert_digest(f, digests[2 * l], digests[2 * l + 1]);
+        }
+    }
+    return inserted;
+}
+
+// Same as `museair_cuckoo_contains` for each key, into `out[n]`.
+static inline void museair_cuckoo_contains_batch(const museair_cuckoo_t* f,
+                                                 const void* const* keys,
+                                                 const size_t* lens,
+                                                 const size_t n,
+                                                 bool* out) {
+    uint64_t digests[2 * MUSEAIR_CUCKOO_BATCH];
+    for (size_t b = 0; b < n; b += MUSEAIR_CUCKOO_BATCH) {
+        const size_t m = n - b < MUSEAIR_CUCKOO_BATCH ? n - b : MUSEAIR_CUCKOO_BATCH;
+        _museair_hash_batch(true, true, keys + b, lens + b, m, f->seed, digests);
+        for (size_t l = 0; l < m; l++) {
+            const uint64_t i1 = _museair_cuckoo_bucket(f, digests[2 * l]);
+            const uint64_t i2 = _museair_cuckoo_alt(f, i1, _museair_cuckoo_fingerprint(digests[2 * l + 1]));
+            _museair_prefetch(&f->buckets[i1], 0);
+            _museair_prefetch(&f->buckets[i2], 0);
+        }
+        for (size_t l = 0; l < m; l++) {
+            out[b + l] = museair_cuckoo_contains_digest(f, digests[2 * l], digests[2 * l + 1]);
+        }
+    }
+}
+
+/*----------------------------------------------------------------------------*/
+
+static inline size_t museair_cuckoo_image_size(const museair_cuckoo_t* f) {
+    return MUSEAIR_CUCKOO_HEADER + (size_t)f->nbuckets * 8;
+}
+
+// Writes the image of `f` to `museair_cuckoo_image_size(f)` bytes at `image`.
+static inline void museair_cuckoo_save(const museair_cuckoo_t* f, void* image) {
+    uint8_t* p = (uint8_t*)image;
+    memset(p, 0, MUSEAIR_CUCKOO_HEADER);
+    memcpy(p, MUSEAIR_CUCKOO_MAGIC, 8);
+    _museair_write_u64(p + 8, f->nbuckets);
+    _museair_write_u64(p + 16, f->seed);
+    _museair_write_u64(p + 24, f->count);
+    _museair_write_u64(p + 32, f->victim);
+    memcpy(p + MUSEAIR_CUCKOO_HEADER, f->buckets, (size_t)f->nbuckets * 8);
+}
+
+// Points `f` at the buckets of the image at `image`, without copying. The image must be 8-byte aligned and outlive
+// `f`, inserts and deletes write to it. Returns false if `image` is not a whole filter image.
+static inline bool museair_cuckoo_load(museair_cuckoo_t* f, const void* image, const size_t size) {
+    const uint8_t* p = (const uint8_t*)image;
+    if (size < MUSEAIR_CUCKOO_HEADER || ((uintptr_t)p & 7) != 0 || memcmp(p, MUSEAIR_CUCKOO_MAGIC, 8) != 0) {
+        return false;
+    }
+    const uint64_t nbuckets = _museair_read_u64(p + 8);
+    if (nbuckets == 0 || nbuckets > _MUSEAIR_CUCKOO_AT || (size - MUSEAIR_CUCKOO_HEADER) % 8 != 0 ||
+        (size - MUSEAIR_CUCKOO_HEADER) / 8 != nbuckets) {
+        return false;
+    }
+    const uint64_t victim = _museair_read_u64(p + 32);
+    if (victim && ((victim & _MUSEAIR_CUCKOO_AT) >= nbuckets || victim >> 48 == 0)) {
+        return false;
+    }
+    f->nbuckets = nbuckets;
+    f->seed = _museair_read_u64(p + 16);
+    f->count = _museair_read_u64(p + 24);
+    f->victim = victim;
+    f->rng = f->seed ^ f->count;
+    f->buckets = (uint64_t*)(uintptr_t)(p + MUSEAIR_CUCKOO_HEADER);
+    f->mem = NULL;
+    return true;
+}
+
+#endif  // MUSEAIR_CUCKOO_H
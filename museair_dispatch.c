@@ -0,0 +1,146 @@
+/*
+ * Runtime dispatched long-input kernels of MuseAir.
+ *
+ * SPDX-License-Identifier: Apache-2.0 OR MIT
+ *
+ * Build this file once and define `MUSEAIR_DISPATCH` wherever "museair.h" is included:
+ *
+ *     cc -O2 -c museair_dispatch.c
+ *     cc -O2 -DMUSEAIR_DISPATCH -c app.c && cc app.o museair_dispatch.o
+ *
+ * Inputs longer than 16 bytes then go through `_museair_hash_loong` / `_museair_hash_loong_128` compiled for
+ * x86-64-v1 (baseline), v2, v3 (BMI2 `mulx`) and v4, the best one supported by the CPU is picked on first use
+ * or at load time, whichever comes first. Short inputs keep the header-only inline path. On other targets the
+ * baseline kernels are used as they are.
+ */
+
+#include "museair.h"
+
+typedef void (*_museair_kernel_t)(const uint8_t*, size_t, uint64_t, uint64_t*, uint64_t*, uint64_t*);
+
+typedef struct {
+    const char* target;
+    _museair_kernel_t hash_loong;
+    _museair_kernel_t hash_loong_128;
+    _museair_kernel_t bfast_hash_loong;
+    _museair_kernel_t bfast_hash_loong_128;
+} _museair_kernels_t;
+
+#define MUSEAIR_DEFINE_KERNELS(NAME, TARGET)                                                                      \
+    static TARGET void _museair_hash_loong_##NAME(const uint8_t* bytes, size_t len, uint64_t seed, uint64_t* i,   \
+                                                  uint64_t* j, uint64_t* k) {                                     \
+        _museair_tower_loong(false, bytes, len, seed, i, j, k);                                                   \
+        _museair_epi_loong(false, i, j, k);                                                                       \
+    }                                                                                                             \
+    static TARGET void _museair_hash_loong_128_##NAME(const uint8_t* bytes, size_t len, uint64_t seed,            \
+                                                      uint64_t* i, uint64_t* j, uint64_t* k) {                    \
+        _museair_tower_loong(false, bytes, len, seed, i, j, k);                                                   \
+        _museair_epi_loong_128(false, i, j, k);                                                                   \
+    }                                                                                                             \
+    static TARGET void _museair_bfast_hash_loong_##NAME(const uint8_t* bytes, size_t len, uint64_t seed,          \
+                                                        uint64_t* i, uint64_t* j, uint64_t* k) {                  \
+        _museair_tower_loong(true, bytes, len, seed, i, j, k);                                                    \
+        _museair_epi_loong(true, i, j, k);                                                                        \
+    }                                                                                                             \
+    static TARGET void _museair_bfast_hash_loong_128_##NAME(const uint8_t* bytes, size_t len, uint64_t seed,      \
+                                                            uint64_t* i, uint64_t* j, uint64_t* k) {              \
+        _museair_tower_loong(true, bytes, len, seed, i, j, k);                                                    \
+        _museair_epi_loong_128(true, i, j, k);                                                                    \
+    }                                                                                                             \
+    static const _museair_kernels_t _museair_kernels_##NAME = {                                                   \
+        #NAME, _museair_hash_loong_##NAME, _museair_hash_loong_128_##NAME, _museair_bfast_hash_loong_##NAME,      \
+        _museair_bfast_hash_loong_128_##NAME,                                                                     \
+    };
+
+#if (defined(__GNUC__) || defined(__clang__)) && defined(__x86_64__)
+    #define MUSEAIR_DISPATCH_X86 1
+#else
+    #define MUSEAIR_DISPATCH_X86 0
+#endif
+
+MUSEAIR_DEFINE_KERNELS(baseline, NEVER_INLINE)
+#if MUSEAIR_DISPATCH_X86
+MUSEAIR_DEFINE_KERNELS(x86_64_v2, NEVER_INLINE __attribute__((__target__("arch=x86-64-v2"))))
+MUSEAIR_DEFINE_KERNELS(x86_64_v3, NEVER_INLINE __attribute__((__target__("arch=x86-64-v3"))))
+MUSEAIR_DEFINE_KERNELS(x86_64_v4, NEVER_INLINE __attribute__((__target__("arch=x86-64-v4"))))
+#endif
+
+/*----------------------------------------------------------------------------*/
+
+static const _museair_kernels_t* _museair_select(void) {
+#if MUSEAIR_DISPATCH_X86
+    __builtin_cpu_init();
+    bool v2 = __builtin_cpu_supports("sse4.2") && __builtin_cpu_supports("popcnt");
+    bool v3 = v2 && __builtin_cpu_supports("avx2") && __builtin_cpu_supports("bmi") &&
+              __builtin_cpu_supports("bmi2") && __builtin_cpu_supports("fma");
+    bool v4 = v3 && __builtin_cpu_supports("avx512f") && __builtin_cpu_supports("avx512bw") &&
+              __builtin_cpu_supports("avx512cd") && __builtin_cpu_supports("avx512dq") &&
+              __builtin_cpu_supports("avx512vl");
+    if (v4) {
+        return &_museair_kernels_x86_64_v4;
+    }
+    if (v3) {
+        return &_museair_kernels_x86_64_v3;
+    }
+    if (v2) {
+        return &_museair_kernels_x86_64_v2;
+    }
+#endif
+    return &_museair_kernels_baseline;
+}
+
+static const _museair_kernels_t* _museair_kernels = NULL;
+
+static const _museair_kernels_t* _museair_kernels_get(void) {
+    const _museair_kernels_t* k = __atomic_load_n(&_museair_kernels, __ATOMIC_ACQUIRE);
+    if (_museair_unlikely(!k)) {
+        // Racing threads all store the same pointer.
+        k = _museair_select();
+        __atomic_store_n(&_museair_kernels, k, __ATOMIC_RELEASE);
+    }
+    return k;
+}
+
+__attribute__((__constructor__)) static void _museair_dispatch_init(void) {
+    _museair_kernels_get();
+}
+
+/*----------------------------------------------------------------------------*/
+
+void museair_dispatch_hash_loong(const uint8_t* bytes,
+                                 size_t len,
+                                 uint64_t seed,
+                                 uint64_t* i,
+                                 uint64_t* j,
+                                 uint64_t* k) {
+    _museair_kernels_get()->hash_loong(bytes, len, seed, i, j, k);
+}
+void museair_dispatch_hash_loong_128(const uint8_t* bytes,
+                                     size_t len,
+                                     uint64_t seed,
+                                     uint64_t* i,
+                                     uint64_t* j,
+                                     uint64_t* k) {
+    _museair_kernels_get()->hash_loong_128(bytes, len, seed, i, j, k);
+}
+void museair_dispatch_bfast_hash_loong(const uint8_t* bytes,
+                                       size_t len,
+                                       uint64_t seed,
+                                       uint64_t* i,
+                                       uint64_t* j,
+                                       uint64_t* k) {
+    _museair_kernels_get()->bfast_hash_loong(bytes, len, seed, i, j, k);
+}
+void museair_dispatch_bfast_hash_loong_128(const uint8_t* bytes,
+                                           size_t len,
+                                           uint64_t seed,
+                                           uint64_t* i,
+                                           uint64_t* j,
+                                           uint64_t* k) {
+    _museair_kernels_get()->bfast_hash_loong_128(bytes, len, seed, i, j, k);
+}
+
+// Name of the selected kernels, for diagnostics: "baseline", "x86_64_v2", "x86_64_v3" or "x86_64_v4".
+const char* museair_dispatch_target(void) {
+    return _museair_kernels_get()->target;
+}
@@ -0,0 +1,562 @@
+/*
+ * Open-addressing hash map on MuseAir, in the style of Swiss tables. Requires C++17.
+ *
+ * SPDX-License-Identifier: Apache-2.0 OR MIT
+ *
+ *     museair::flat_map<std::string, int> m;
+ *     m["alpha"] = 1;
+ *     m.find(std::string_view("alpha"));  // heterogeneous lookup, no temporary std::string.
+ *
+ * Entries live in a single array of slots, next to an array of one control byte per slot (plus `GROUP - 1`
+ * mirrored bytes so that a group can be loaded at any slot). A control byte is either empty, deleted, or the low
+ * 7 bits of the hash of a full slot. The remaining bits of the hash pick the first group to probe, groups are
+ * then visited by triangular steps, and in each group the candidates are found by comparing all control bytes
+ * with the tag at once (16 per SSE2 compare, or 8 per SWAR word elsewhere).
+ *
+ * Unlike `std::unordered_map`, inserting or rehashing moves entries and invalidates iterators and references.
+ * `value_type` is `std::pair<const Key, T>`, rehashing moves keys out of the old slots rather than copying them.
+ */
+
+#ifndef MUSEAIR_FLAT_MAP_HPP
+#define MUSEAIR_FLAT_MAP_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <initializer_list>
+#include <iterator>
+#include <memory>
+#include <new>
+#include <stdexcept>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+#if defined(__SSE2__) || defined(_M_X64)
+    #include <emmintrin.h>
+    #define MUSEAIR_FLAT_MAP_SSE2 1
+#else
+    #define MUSEAIR_FLAT_MAP_SSE2 0
+#endif
+
+#include "museair.hpp"
+
+namespace museair {
+
+namespace flat_detail {
+
+using ctrl_t = std::int8_t;
+
+inline constexpr ctrl_t EMPTY = -128;   // 0b10000000
+inline constexpr ctrl_t DELETED = -2;   // 0b11111110
+// Full slots hold their 7-bit tag, so "empty or deleted" is just the high bit.
+
+inline std::size_t ctz(std::uint64_t v) {
+#if defined(__GNUC__) || defined(__clang__)
+    return static_cast<std::size_t>(__builtin_ctzll(v));
+#else
+    return static_cast<std::size_t>(_museair_ctz64(v));
+#endif
+}
+
+inline std::size_t clz(std::uint64_t v) {
+#if defined(__GNUC__) || defined(__clang__)
+    return static_cast<std::size_t>(__builtin_clzll(v));
+#else
+    std::size_t n = 0;
+    for (; !(v >> 63); v <<= 1) {
+        n++;
+    }
+    return n;
+#endif
+}
+
+template <typename F, typename = void>
+struct is_transparent : std::false_type {};
+template <typename F>
+struct is_transparent<F, std::void_t<typename F::is_transparent>> : std::true_type {};
+
+// Unlike `std::conditional_t`, keeps `K` deducible when `Transparent`.
+template <bool Transparent>
+struct key_arg {
+    template <typename K, typename Key>
+    using type = K;
+};
+template <>
+struct key_arg<false> {
+    template <typename K, typename Key>
+    using type = Key;
+};
+
+// Set of slots within a group of `Width` slots, `Shift` is log2 of the bits per slot.
+template <std::size_t Width, int Shift>
+class bitmask {
+   public:
+    explicit bitmask(std::uint64_t bits) : bits_(bits) {}
+    explicit operator bool() const { return bits_ != 0; }
+    std::size_t lowest() const { return ctz(bits_) >> Shift; }
+    void clear_lowest() { bits_ &= bits_ - 1; }
+    // Slots before the first / after the last one in the set, which must not be empty.
+    std::size_t leading_absent() const { return ctz(bits_) >> Shift; }
+    std::size_t trailing_absent() const { return (clz(bits_) - (64 - (Width << Shift))) >> Shift; }
+
+   private:
+    std::uint64_t bits_;
+};
+
+#if MUSEAIR_FLAT_MAP_SSE2
+
+struct group {
+    static constexpr std::size_t WIDTH = 16;
+    using mask = bitmask<16, 0>;
+
+    explicit group(const ctrl_t* p) : ctrl(_mm_loadu_si128(reinterpret_cast<const __m128i*>(p))) {}
+
+    mask match(ctrl_t tag) const {
+        return mask(static_cast<std::uint32_t>(_mm_movemask_epi8(_mm_cmpeq_epi8(ctrl, _mm_set1_epi8(tag)))));
+    }
+    mask match_empty() const { return match(EMPTY); }
+    mask match_empty_or_deleted() const { return mask(static_cast<std::uint32_t>(_mm_movemask_epi8(ctrl))); }
+
+    __m128i ctrl;
+};
+
+#else
+
+struct group {
+    static constexpr std::size_t WIDTH = 8;
+    using mask = bitmask<8, 3>;
+    static constexpr std::uint64_t LSBS = UINT64_C(0x0101010101010101), MSBS = UINT64_C(0x8080808080808080);
+
+    explicit group(const ctrl_t* p) {
+        std::memcpy(&ctrl, p, 8);
+#if MUSEAIR_BSWAP > 0
+        ctrl = _museair_bswap_64(ctrl);  // slot `n` in byte `n` from the bottom.
+#endif
+    }
+
+    // May report a false match right after a true one, candidates are compared anyway.
+    mask match(ctrl_t tag) const {
+        std::uint64_t x = ctrl ^ (LSBS * static_cast<std::uint8_t>(tag));
+        return mask((x - LSBS) & ~x & MSBS);
+    }
+    mask match_empty() const { return mask(ctrl & ~(ctrl << 6) & MSBS); }
+    mask match_empty_or_deleted() const { return mask(ctrl & MSBS); }
+
+    std::uint64_t ctrl;
+};
+
+#endif
+
+}  // namespace flat_detail
+
+template <typename Key, typename T, typename Hash = hasher, typename KeyEqual = equal_to>
+class flat_map {
+    using ctrl_t = flat_detail::ctrl_t;
+    using group = flat_detail::group;
+    static constexpr std::size_t GROUP = group::WIDTH;
+
+    static constexpr bool transparent =
+        flat_detail::is_transparent<Hash>::value && flat_detail::is_transparent<KeyEqual>::value;
+    // Lookup key type: any `K` with transparent functors, `Key` otherwise (where `K` is then not deducible).
+    template <typename K>
+    using key_arg = typename flat_detail::key_arg<transparent>::template type<K, Key>;
+    template <typename K>
+    static constexpr bool is_key = std::is_same_v<std::remove_cv_t<std::remove_reference_t<K>>, Key>;
+
+   public:
+    using key_type = Key;
+    using mapped_type = T;
+    using value_type = std::pair<const Key, T>;
+    using size_type = std::size_t;
+    using hasher = Hash;
+    using key_equal = KeyEqual;
+
+    template <bool Const>
+    class basic_iterator {
+        friend class flat_map;
+        using map_ptr = std::conditional_t<Const, const flat_map*, flat_map*>;
+
+       public:
+        using iterator_category = std::forward_iterator_tag;
+        using value_type = flat_map::value_type;
+        using difference_type = std::ptrdiff_t;
+        using reference = std::conditional_t<Const, const value_type&, value_type&>;
+        using pointer = std::conditional_t<Const, const value_type*, value_type*>;
+
+        basic_iterator() = default;
+        template <bool C = Const, typename = std::enable_if_t<C>>
+        basic_iterator(const basic_iterator<false>& it) : map_(it.map_), index_(it.index_) {}
+
+        reference operator*() const { return map_->slots_[index_]; }
+        pointer operator->() const { return &map_->slots_[index_]; }
+        basic_iterator& operator++() {
+            index_ = map_->next_full(index_ + 1);
+            return *this;
+        }
+        basic_iterator operator++(int) {
+            basic_iterator it = *this;
+            ++*this;
+            return it;
+        }
+        friend bool operator==(const basic_iterator& a, const basic_iterator& b) { return a.index_ == b.index_; }
+        friend bool operator!=(const basic_iterator& a, const basic_iterator& b) { return a.index_ != b.index_; }
+
+       private:
+        basic_iterator(map_ptr map, std::size_t index) : map_(map), index_(index) {}
+
+        map_ptr map_ = nullptr;
+        std::size_t index_ = 0;
+    };
+    using iterator = basic_iterator<false>;
+    using const_iterator = basic_iterator<true>;
+
+    flat_map() = default;
+    explicit flat_map(std::size_t n, const Hash& hash = Hash(), const KeyEqual& eq = KeyEqual())
+        : hash_(hash), eq_(eq) {
+        reserve(n);
+    }
+    flat_map(std::initializer_list<value_type> init) {
+        reserve(init.size());
+        for (const value_type& v : init) {
+            insert(v);
+        }
+    }
+    flat_map(const flat_map& o) : hash_(o.hash_), eq_(o.eq_) {
+        reserve(o.size_);
+        for (const value_type& v : o) {
+            insert_unique(hash_of(v.first), v);
+        }
+    }
+    flat_map(flat_map&& o) noexcept
+        : hash_(std::move(o.hash_)),
+          eq_(std::move(o.eq_)),
+          ctrl_(std::exchange(o.ctrl_, nullptr)),
+          slots_(std::exchange(o.slots_, nullptr)),
+          capacity_(std::exchange(o.capacity_, 0)),
+          size_(std::exchange(o.size_, 0)),
+          growth_left_(std::exchange(o.growth_left_, 0)) {}
+    flat_map& operator=(const flat_map& o) {
+        if (this != &o) {
+            flat_map copy(o);
+            swap(copy);
+        }
+        return *this;
+    }
+    flat_map& operator=(flat_map&& o) noexcept {
+        flat_map moved(std::move(o));
+        swap(moved);
+        return *this;
+    }
+    ~flat_map() { release(); }
+
+    void swap(flat_map& o) noexcept {
+        using std::swap;
+        swap(hash_, o.hash_);
+        swap(eq_, o.eq_);
+        swap(ctrl_, o.ctrl_);
+        swap(slots_, o.slots_);
+        swap(capacity_, o.capacity_);
+        swap(size_, o.size_);
+        swap(growth_left_, o.growth_left_);
+    }
+
+    iterator begin() { return iterator(this, next_full(0)); }
+    iterator end() { return iterator(this, capacity_); }
+    const_iterator begin() const { return const_iterator(this, next_full(0)); }
+    const_iterator end() const { return const_iterator(this, capacity_); }
+    const_iterator cbegin() const { return begin(); }
+    const_iterator cend() const { return end(); }
+
+    bool empty() const { return size_ == 0; }
+    std::size_t size() const { return size_; }
+    std::size_t capacity() const { return capacity_; }
+    float load_factor() const { return capacity_ ? static_cast<float>(size_) / static_cast<float>(capacity_) : 0; }
+    static constexpr float max_load_factor() { return 7.0f / 8.0f; }
+    hasher hash_function() const { return hash_; }
+    key_equal key_eq() const { return eq_; }
+
+    void clear() {
+        destroy_slots();
+        if (capacity_) {
+            reset_ctrl();
+        }
+    }
+
+    // Makes room for `n` entries in total without further rehashing.
+    void reserve(std::size_t n) {
+        if (n > size_ + growth_left_) {
+            resize(capacity_for(n));
+        }
+    }
+
+    template <typename K = Key>
+    iterator find(const key_arg<K>& key) {
+        return iterator(this, find_index(key));
+    }
+    template <typename K = Key>
+    const_iterator find(const key_arg<K>& key) const {
+        return const_iterator(this, find_index(key));
+    }
+    template <typename K = Key>
+    bool contains(const key_arg<K>& key) const {
+        return find_index(key) != capacity_;
+    }
+    template <typename K = Key>
+    std::size_t count(const key_arg<K>& key) const {
+        return contains(key) ? 1 : 0;
+    }
+    template <typename K = Key>
+    T& at(const key_arg<K>& key) {
+        std::size_t n = find_index(key);
+        if (n == capacity_) {
+            throw std::out_of_range("museair::flat_map::at");
+        }
+        return slots_[n].second;
+    }
+    template <typename K = Key>
+    const T& at(const key_arg<K>& key) const {
+        return const_cast<flat_map*>(this)->at(key);
+    }
+
+    template <typename... Args>
+    std::pair<iterator, bool> try_emplace(const Key& key, Args&&... args) {
+        return emplace_key(key, std::forward<Args>(args)...);
+    }
+    template <typename... Args>
+    std::pair<iterator, bool> try_emplace(Key&& key, Args&&... args) {
+        return emplace_key(std::move(key), std::forward<Args>(args)...);
+    }
+    // Heterogeneous key, converted to `Key` only if it is inserted.
+    template <typename K, typename... Args, typename = std::enable_if_t<transparent && !is_key<K>>>
+    std::pair<iterator, bool> try_emplace(K&& key, Args&&... args) {
+        return emplace_key(std::forward<K>(key), std::forward<Args>(args)...);
+    }
+
+    std::pair<iterator, bool> insert(const value_type& v) { return emplace_key(v.first, v.second); }
+    std::pair<iterator, bool> insert(value_type&& v) { return emplace_key(std::move(v.first), std::move(v.second)); }
+    template <typename... Args>
+    std::pair<iterator, bool> emplace(Args&&... args) {
+        value_type v(std::forward<Args>(args)...);
+        return insert(std::move(v));
+    }
+    template <typename K, typename M>
+    std::pair<iterator, bool> insert_or_assign(K&& key, M&& value) {
+        auto r = try_emplace(std::forward<K>(key), std::forward<M>(value));
+        if (!r.second) {
+            r.first->second = std::forward<M>(value);
+        }
+        return r;
+    }
+
+    T& operator[](const Key& key) { return emplace_key(key).first->second; }
+    T& operator[](Key&& key) { return emplace_key(std::move(key)).first->second; }
+    template <typename K, typename = std::enable_if_t<transparent && !is_key<K>>>
+    T& operator[](K&& key) {
+        return emplace_key(std::forward<K>(key)).first->second;
+    }
+
+    template <typename K = Key>
+    std::size_t erase(const key_arg<K>& key) {
+        std::size_t n = find_index(key);
+        if (n == capacity_) {
+            return 0;
+        }
+        erase_at(n);
+        return 1;
+    }
+    // Returns the iterator following `it`, erasing does not move other entries.
+    iterator erase(const_iterator it) {
+        erase_at(it.index_);
+        return iterator(this, next_full(it.index_ + 1));
+    }
+    iterator erase(iterator it) { return erase(const_iterator(it)); }
+
+   private:
+    template <typename K>
+    std::size_t hash_of(const K& key) const {
+        return static_cast<std::size_t>(hash_(key));
+    }
+    static ctrl_t tag(std::size_t h) { return static_cast<ctrl_t>(h & 0x7f); }
+    static std::size_t home(std::size_t h) { return h >> 7; }
+
+    // Smallest power of two of at least `GROUP` slots holding `n` entries under the maximum load factor.
+    static std::size_t capacity_for(std::size_t n) {
+        std::size_t c = GROUP;
+        while (c - c / 8 < n) {
+            c *= 2;
+        }
+        return c;
+    }
+
+    void set_ctrl(std::size_t n, ctrl_t c) {
+        ctrl_[n] = c;
+        if (n < GROUP - 1) {
+            ctrl_[capacity_ + n] = c;  // mirror, for groups loaded near the end.
+        }
+    }
+
+    void reset_ctrl() {
+        std::memset(ctrl_, static_cast<std::uint8_t>(flat_detail::EMPTY), capacity_ + GROUP - 1);
+        growth_left_ = capacity_ - capacity_ / 8;
+    }
+
+    std::size_t next_full(std::size_t n) const {
+        while (n < capacity_ && ctrl_[n] < 0) {
+            n++;
+        }
+        return n;
+    }
+
+    template <typename K>
+    std::size_t find_index(const K& key) const {
+        return find_index(key, hash_of(key));
+    }
+
+    template <typename K>
+    std::size_t find_index(const K& key, std::size_t h) const {
+        if (capacity_ == 0) {
+            return 0;
+        }
+        const std::size_t mask = capacity_ - 1;
+        std::size_t pos = home(h) & mask;
+        for (std::size_t step = GROUP;; step += GROUP) {
+            group g(ctrl_ + pos);
+            for (auto m = g.match(tag(h)); m; m.clear_lowest()) {
+                std::size_t n = (pos + m.lowest()) & mask;
+                if (eq_(slots_[n].first, key)) {
+                    return n;
+                }
+            }
+            if (g.match_empty()) {
+                return capacity_;
+            }
+            pos = (pos + step) & mask;
+        }
+    }
+
+    // First empty or deleted slot on the probe sequence of `h`, there is always one.
+    std::size_t find_free(std::size_t h) const {
+        const std::size_t mask = capacity_ - 1;
+        std::size_t pos = home(h) & mask;
+        for (std::size_t step = GROUP;; step += GROUP) {
+            auto m = group(ctrl_ + pos).match_empty_or_deleted();
+            if (m) {
+                return (pos + m.lowest()) & mask;
+            }
+            pos = (pos + step) & mask;
+        }
+    }
+
+    // Claims a slot for a key known to be absent, growing (or purging deleted slots) first if needed.
+    std::size_t prepare_insert(std::size_t h) {
+        std::size_t n = capacity_ ? find_free(h) : 0;
+        if (capacity_ == 0 || (growth_left_ == 0 && ctrl_[n] == flat_detail::EMPTY)) {
+            // Rehash into a new table of the same capacity when deleted slots, not entries, used up the growth
+            // budget. Both tables are live during the rehash, so this briefly doubles the memory of the map.
+            resize(size_ < (capacity_ - capacity_ / 8) / 2 ? capacity_ : capacity_for(size_ + 1));
+            n = find_free(h);
+        }
+        growth_left_ -= ctrl_[n] == flat_detail::EMPTY;
+        set_ctrl(n, tag(h));
+        size_++;
+        return n;
+    }
+
+    template <typename K, typename... Args>
+    std::pair<iterator, bool> emplace_key(K&& key, Args&&... args) {
+        std::size_t h = hash_of(key);
+        std::size_t n = find_index(key, h);
+        if (n != capacity_) {
+            return {iterator(this, n), false};
+        }
+        n = prepare_insert(h);
+        ::new (static_cast<void*>(&slots_[n]))
+            value_type(std::piecewise_construct, std::forward_as_tuple(std::forward<K>(key)),
+                       std::forward_as_tuple(std::forward<Args>(args)...));
+        return {iterator(this, n), true};
+    }
+
+    template <typename V>
+    void insert_unique(std::size_t h, V&& v) {
+        std::size_t n = prepare_insert(h);
+        ::new (static_cast<void*>(&slots_[n])) value_type(std::forward<V>(v));
+    }
+
+    void erase_at(std::size_t n) {
+        slots_[n].~value_type();
+        size_--;
+        // A slot can go back to empty if no probe ever passed it full: its group window then has an empty slot
+        // before and after it, with no full group of `GROUP` slots in between.
+        const std::size_t mask = capacity_ - 1;
+        std::size_t before = (n - GROUP) & mask;
+        auto empty_after = group(ctrl_ + n).match_empty();
+        auto empty_before = group(ctrl_ + before).match_empty();
+        if (empty_before && empty_after && empty_before.trailing_absent() + empty_after.leading_absent() < GROUP) {
+            set_ctrl(n, flat_detail::EMPTY);
+            growth_left_++;
+        } else {
+            set_ctrl(n, flat_detail::DELETED);
+        }
+    }
+
+    void resize(std::size_t capacity) {
+        ctrl_t* old_ctrl = ctrl_;
+        value_type* old_slots = slots_;
+        std::size_t old_capacity = capacity_;
+
+        ctrl_ = static_cast<ctrl_t*>(::operator new(capacity + GROUP - 1));
+        slots_ = std::allocator<value_type>().allocate(capacity);
+        capacity_ = capacity;
+        reset_ctrl();
+        size_ = 0;
+        for (std::size_t n = 0; n < old_capacity; n++) {
+            if (old_ctrl[n] >= 0) {
+                transfer(&slots_[prepare_insert(hash_of(old_slots[n].first))], &old_slots[n]);
+            }
+        }
+        if (old_capacity) {
+            std::allocator<value_type>().deallocate(old_slots, old_capacity);
+            ::operator delete(old_ctrl);
+        }
+    }
+
+    // Moves the entry at `from` into the raw slot `to` and ends the life of `from`. Its key is const only to users,
+    // it is moved out right before being destroyed and never read again, as node handles of `std::map` do.
+    static void transfer(value_type* to, value_type* from) {
+        ::new (static_cast<void*>(to)) value_type(std::piecewise_construct,
+                                                  std::forward_as_tuple(std::move(const_cast<Key&>(from->first))),
+                                                  std::forward_as_tuple(std::move(from->second)));
+        from->~value_type();
+    }
+
+    void destroy_slots() {
+        if (!std::is_trivially_destructible_v<value_type>) {
+            for (std::size_t n = 0; n < capacity_; n++) {
+                if (ctrl_[n] >= 0) {
+                    slots_[n].~value_type();
+                }
+            }
+        }
+        size_ = 0;
+    }
+
+    void release() {
+        if (capacity_) {
+            destroy_slots();
+            std::allocator<value_type>().deallocate(slots_, capacity_);
+            ::operator delete(ctrl_);
+        }
+    }
+
+    [[no_unique_address]] Hash hash_;
+    [[no_unique_address]] KeyEqual eq_;
+    ctrl_t* ctrl_ = nullptr;
+    value_type* slots_ = nullptr;
+    std::size_t capacity_ = 0;
+    std::size_t size_ = 0;
+    std::size_t growth_left_ = 0;  // empty slots that may still be filled under the maximum load factor.
+};
+
+}  // namespace museair
+
+#endif  // MUSEAIR_FLAT_MAP_HPP
@@ -0,0 +1,359 @@
+/*
+ * Binary fuse filter over MuseAir digests, a static set filter of about 9 bits per key. Link with `-lm`.
+ *
+ * SPDX-License-Identifier: Apache-2.0 OR MIT
+ *
+ * Follows "Binary Fuse Filters: Fast and Smaller Than Xor Filters" (Graf and Lemire, 2022), with 3 hash positions
+ * and 8-bit fingerprints: the false positive rate is 1/256 and the filter takes 1.125 bytes per key for large sets
+ * (more for small ones). A key is hashed once with `museair_bfast_hash_128(key, len, seed)`, the lower half gives
+ * its three positions and the low byte of the upper half its fingerprint, so a query reads three bytes, mostly from
+ * two nearby cache lines.
+ *
+ * Building peels a random hypergraph, which fails with a small probability, then the keys are hashed again with the
+ * next seed. A few duplicate keys are skipped. `museair_fuse_build` hashes the keys on `threads` POSIX threads, the
+ * peeling itself is sequential and takes most of the build time; define `MUSEAIR_FUSE_NO_THREADS` to leave threads
+ * out. It needs about 35 bytes per key while building.
+ *
+ * An image is `MUSEAIR_FUSE_MAGIC`, the seed and the four 32-bit shape fields of `museair_fuse_t` in its header, then
+ * the fingerprint bytes.
+ */
+
+#ifndef MUSEAIR_FUSE_H
+#define MUSEAIR_FUSE_H
+
+#include "museair.h"
+
+#include <math.h>
+#include <stdlib.h>
+#ifndef MUSEAIR_FUSE_NO_THREADS
+    #include <pthread.h>
+    #include <unistd.h>
+#endif
+
+#define MUSEAIR_FUSE_MAGIC "MuseFus1"
+#define MUSEAIR_FUSE_HEADER 64
+#define MUSEAIR_FUSE_ATTEMPTS 100
+#define MUSEAIR_FUSE_BATCH 16  // keys whose three fingerprints `museair_fuse_contains_batch` prefetches together.
+
+typedef struct {
+    uint64_t seed;
+    uint32_t segment_length;  // a power of two.
+    uint32_t segment_count_length;
+    uint32_t array_length;  // `segment_count_length + 2 * segment_length` fingerprints.
+    uint32_t reserved;
+    const uint8_t* fingerprints;
+    void* mem;  // allocation behind `fingerprints`, NULL for a loaded image.
+} museair_fuse_t;
+
+/*----------------------------------------------------------------------------*/
+
+static FORCE_INLINE void _museair_fuse_positions(const museair_fuse_t* f, uint64_t lo, uint32_t* h) {
+    uint64_t unused, h0;
+    _museair_wmul(&unused, &h0, lo, f->segment_count_length);
+    const uint32_t mask = f->segment_length - 1;
+    h[0] = (uint32_t)h0;
+    h[1] = (h[0] + f->segment_length) ^ ((uint32_t)(lo >> 18) & mask);
+    h[2] = (h[0] + 2 * f->segment_length) ^ ((uint32_t)lo & mask);
+}
+
+// Sizes `f` for `n` keys, as in the reference implementation.
+static inline void _museair_fuse_shape(museair_fuse_t* f, const size_t n) {
+    uint32_t segment_length = n <= 1 ? 4 : UINT32_C(1) << (int)floor(log((double)n) / log(3.33) + 2.25);
+    segment_length = segment_length > 262144 ? 262144 : segment_length;
+    const double size_factor = n <= 1 ? 0 : fmax(1.125, 0.875 + 0.25 * log(1000000.0) / log((double)n));
+    const uint64_t capacity = (uint64_t)round((double)n * size_factor);
+    int64_t segment_count = (int64_t)((capacity + segment_length - 1) / segment_length) - 2;
+    segment_count = segment_count < 1 ? 1 : segment_count;
+    f->segment_length = segment_length;
+    f->segment_count_length = (uint32_t)segment_count * segment_length;
+    f->array_length = (uint32_t)(segment_count + 2) * segment_length;
+}
+
+typedef struct {
+    const void* const* keys;
+    const size_t* lens;
+    size_t n;
+    uint64_t seed;
+    size_t next;  // next chunk of keys to claim, shared by all workers.
+    uint64_t* los;
+    uint8_t* fps;
+} _museair_fuse_job_t;
+
+#define _MUSEAIR_FUSE_CHUNK 4096
+
+static void* _museair_fuse_worker(void* arg) {
+    _museair_fuse_job_t* job = (_museair_fuse_job_t*)arg;
+    uint64_t digests[2 * 64];
+    for (;;) {
+#ifndef MUSEAIR_FUSE_NO_THREADS
+        size_t begin = __atomic_fetch_add(&job->next, _MUSEAIR_FUSE_CHUNK, __ATOMIC_RELAXED);
+#else
+        size_t begin = job->next;
+        job->next += _MUSEAIR_FUSE_CHUNK;
+#endif
+        if (begin >= job->n) {
+            return NULL;
+        }
+        size_t end = job->n - begin < _MUSEAIR_FUSE_CHUNK ? job->n : begin + _MUSEAIR_FUSE_CHUNK;
+        for (size_t b = begin; b < end; b += 64) {
+            const size_t m = end - b < 64 ? end - b : 64;
+            _museair_hash_batch(true, true, job->keys + b, job->lens + b, m, job->seed, digests);
+            for (size_t l = 0; l < m; l++) {
+                job->los[b + l] = digests[2 * l] + (digests[2 * l] == 0);  // 0 marks free places below.
+                job->fps[b + l] = (uint8_t)digests[2 * l + 1];
+            }
+        }
+    }
+}
+
+// Hashes every key with `job->seed` into `job->los` and `job->fps`.
+static inline void _museair_fuse_hash(_museair_fuse_job_t* job, int threads) {
+    job->next = 0;
+#ifndef MUSEAIR_FUSE_NO_THREADS
+    pthread_t* pool = threads > 1 ? (pthread_t*)malloc(sizeof(pthread_t) * (size_t)threads) : NULL;
+    int spawned = 0;
+    while (pool && spawned < threads - 1 && pthread_create(&pool[spawned], NULL, _museair_fuse_worker, job) == 0) {
+        spawned++;
+    }
+    _museair_fuse_worker(job);
+    for (int n = 0; n < spawned; n++) {
+        pthread_join(pool[n], NULL);
+    }
+    free(pool);
+#else
+    (void)threads;
+    _museair_fuse_worker(job);
+#endif
+}
+
+// One peeling attempt on the digests of `job`, writes the fingerprints on success.
+static inline bool _museair_fuse_peel(museair_fuse_t* f, uint8_t* fingerprints, const _museair_fuse_job_t* job) {
+    const size_t n = job->n, capacity = f->array_length;
+    uint64_t* order = (uint64_t*)calloc(n + 1, sizeof(uint64_t));
+    uint8_t* order_fps = (uint8_t*)malloc(n + 1);
+    uint8_t* found = (uint8_t*)malloc(n + 1);
+    uint32_t* alone = (uint32_t*)malloc(capacity * sizeof(uint32_t));
+    uint8_t* t2count = (uint8_t*)calloc(capacity, 1);
+    uint8_t* t2fp = (uint8_t*)calloc(capacity, 1);
+    uint64_t* t2hash = (uint64_t*)calloc(capacity, sizeof(uint64_t));
+    uint32_t block_bits = 1;
+    while ((UINT32_C(1) << block_bits) < f->segment_count_length / f->segment_length) {
+        block_bits++;
+    }
+    size_t* start = (size_t*)malloc(((size_t)1 << block_bits) * sizeof(size_t));
+    bool ok = order && order_fps && found && alone && t2count && t2fp && t2hash && start;
+
+    // Lays the digests out by segment, so that the counting pass walks the arrays mostly in order.
+    const size_t blocks = (size_t)1 << block_bits;
+    for (size_t b = 0; ok && b < blocks; b++) {
+        start[b] = (size_t)(((uint64_t)b * n) >> block_bits);
+    }
+    order[n] = 1;  // stops the probe for a free place at the end.
+    for (size_t i = 0; ok && i < n; i++) {
+        size_t b = (size_t)(job->los[i] >> (64 - block_bits));
+        while (order[start[b]] != 0) {
+            b = (b + 1) & (blocks - 1);
+        }
+        order[start[b]] = job->los[i];
+        order_fps[start[b]++] = job->fps[i];
+    }
+
+    // Each position accumulates the count (times 4), xor of digests, fingerprints and slot numbers of its keys.
+    size_t duplicates = 0;
+    uint32_t h[5];
+    for (size_t i = 0; ok && i < n; i++) {
+        const uint64_t lo = order[i];
+        _museair_fuse_positions(f, lo, h);
+        for (uint32_t s = 0; s < 3; s++) {
+            t2count[h[s]] = (uint8_t)((t2count[h[s]] + 4) ^ s);
+            t2hash[h[s]] ^= lo;
+            t2fp[h[s]] ^= order_fps[i];
+        }
+        // A second copy of a key cancels the first: both leave a position of count 2, no digest and no fingerprint.
+        // Distinct keys of the same digest but other fingerprints are kept, they fail the peel and the next seed is
+        // tried; of the same fingerprint too, one of them answers for both.
+        bool copy = false;
+        for (uint32_t s = 0; s < 3; s++) {
+            copy |= t2hash[h[s]] == 0 && t2count[h[s]] == 8 && t2fp[h[s]] == 0;
+        }
+        if (copy) {
+            duplicates++;
+            for (uint32_t s = 0; s < 3; s++) {
+                t2count[h[s]] = (uint8_t)((t2count[h[s]] ^ s) - 4);
+                t2hash[h[s]] ^= lo;
+                t2fp[h[s]] ^= order_fps[i];
+            }
+        }
+        ok &= t2count[h[0]] >= 4 && t2count[h[1]] >= 4 && t2count[h[2]] >= 4;  // counts overflowed.
+    }
+
+    // Peels positions holding a single key, each freeing its key from the two other positions.
+    size_t queued = 0, stack = 0;
+    for (uint32_t i = 0; ok && i < capacity; i++) {
+        alone[queued] = i;
+        queued += (t2count[i] >> 2) == 1;
+    }
+    while (ok && queued > 0) {
+        const uint32_t at = alone[--queued];
+        if ((t2count[at] >> 2) != 1) {
+            continue;
+        }
+        const uint64_t lo = t2hash[at];
+        const uint8_t fp = t2fp[at], slot = t2count[at] & 3;
+        _museair_fuse_positions(f, lo, h);
+        h[3] = h[0], h[4] = h[1];
+        order[stack] = lo;
+        order_fps[stack] = fp;
+        found[stack++] = slot;
+        for (uint32_t s = 1; s <= 2; s++) {
+            const uint32_t other = h[slot + s];
+            alone[queued] = other;
+            queued += (t2count[other] >> 2) == 2;
+            t2count[other] = (uint8_t)((t2count[other] - 4) ^ ((slot + s) % 3));
+            t2hash[other] ^= lo;
+            t2fp[other] ^= fp;
+        }
+    }
+    ok &= stack + duplicates == n;
+
+    // Assigns the fingerprints in reverse peeling order, each key's own position is free to make its xor match.
+    for (size_t i = stack; ok && i-- > 0;) {
+        _museair_fuse_positions(f, order[i], h);
+        h[3] = h[0], h[4] = h[1];
+        fingerprints[h[found[i]]] = order_fps[i] ^ fingerprints[h[found[i] + 1]] ^ fingerprints[h[found[i] + 2]];
+    }
+
+    free(start);
+    free(t2hash);
+    free(t2fp);
+    free(t2count);
+    free(alone);
+    free(found);
+    free(order_fps);
+    free(order);
+    return ok;
+}
+
+/*----------------------------------------------------------------------------*/
+
+// Builds a filter of the `n` keys (fewer than 2^32), hashed on `threads` threads (0 for one per online CPU).
+// `seed` is the first seed tried. Returns false if out of memory, or if every attempt failed, which takes more
+// than a few duplicate digests.
+static inline bool museair_fuse_build(museair_fuse_t* f,
+                                      const void* const* keys,
+                                      const size_t* lens,
+                                      const size_t n,
+                                      const uint64_t seed,
+                                      int threads) {
+    memset(f, 0, sizeof(*f));
+    _museair_fuse_shape(f, n);
+    _museair_fuse_job_t job = {keys, lens, n, seed, 0, NULL, NULL};
+#ifndef MUSEAIR_FUSE_NO_THREADS
+    if (threads <= 0) {
+        long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+        threads = cpus > 0 ? (int)cpus : 1;
+    }
+#endif
+    uint8_t* fingerprints = (uint8_t*)calloc(f->array_length, 1);
+    job.los = (uint64_t*)malloc((n + 1) * sizeof(uint64_t));
+    job.fps = (uint8_t*)malloc(n + 1);
+    bool ok = false;
+    for (int attempt = 0; fingerprints && job.los && job.fps && !ok && attempt < MUSEAIR_FUSE_ATTEMPTS; attempt++) {
+        job.seed = seed + (uint64_t)attempt;
+        _museair_fuse_hash(&job, threads);
+        memset(fingerprints, 0, f->array_length);
+        ok = _museair_fuse_peel(f, fingerprints, &job);
+    }
+    free(job.fps);
+    free(job.los);
+    if (!ok) {
+        free(fingerprints);
+        memset(f, 0, sizeof(*f));
+        return false;
+    }
+    f->seed = job.seed;
+    f->fingerprints = fingerprints;
+    f->mem = fingerprints;
+    return true;
+}
+
+static inline void museair_fuse_free(museair_fuse_t* f) {
+    free(f->mem);
+    f->mem = NULL;
+    f->fingerprints = NULL;
+}
+
+// Returns false if `key` is not in the set, true if it probably is.
+static inline bool museair_fuse_contains(const museair_fuse_t* f, const void* key, const size_t len) {
+    uint64_t hi, lo = museair_bfast_hash_128(key, len, f->seed, &hi);
+    lo += lo == 0;
+    uint32_t h[3];
+    _museair_fuse_positions(f, lo, h);
+    return ((uint8_t)hi ^ f->fingerprints[h[0]] ^ f->fingerprints[h[1]] ^ f->fingerprints[h[2]]) == 0;
+}
+
+// Same as `museair_fuse_contains` for each key, into `out[n]`.
+static inline void museair_fuse_contains_batch(const museair_fuse_t* f,
+                                               const void* const* keys,
+                                               const size_t* lens,
+                                               const size_t n,
+                                               bool* out) {
+    uint64_t digests[2 * MUSEAIR_FUSE_BATCH];
+    uint32_t h[MUSEAIR_FUSE_BATCH][3];
+    for (size_t b = 0; b < n; b += MUSEAIR_FUSE_BATCH) {
+        const size_t m = n - b < MUSEAIR_FUSE_BATCH ? n - b : MUSEAIR_FUSE_BATCH;
+        _museair_hash_batch(true, true, keys + b, lens + b, m, f->seed, digests);
+        for (size_t l = 0; l < m; l++) {
+            _museair_fuse_positions(f, digests[2 * l] + (digests[2 * l] == 0), h[l]);
+            _museair_prefetch(&f->fingerprints[h[l][0]], 0);
+            _museair_prefetch(&f->fingerprints[h[l][1]], 0);
+            _museair_prefetch(&f->fingerprints[h[l][2]], 0);
+        }
+        for (size_t l = 0; l < m; l++) {
+            out[b + l] = ((uint8_t)digests[2 * l + 1] ^ f->fingerprints[h[l][0]] ^ f->fingerprints[h[l][1]] ^
+                          f->fingerprints[h[l][2]]) == 0;
+        }
+    }
+}
+
+static inline size_t museair_fuse_image_size(const museair_fuse_t* f) {
+    return MUSEAIR_FUSE_HEADER + f->array_length;
+}
+
+// Writes the image of `f` to `museair_fuse_image_size(f)` bytes at `image`.
+static inline void museair_fuse_save(const museair_fuse_t* f, void* image) {
+    uint8_t* p = (uint8_t*)image;
+    memset(p, 0, MUSEAIR_FUSE_HEADER);
+    memcpy(p, MUSEAIR_FUSE_MAGIC, 8);
+    _museair_write_u64(p + 8, f->seed);
+    _museair_write_u32(p + 16, f->segment_length);
+    _museair_write_u32(p + 20, f->segment_count_length);
+    _museair_write_u32(p + 24, f->array_length);
+    memcpy(p + MUSEAIR_FUSE_HEADER, f->fingerprints, f->array_length);
+}
+
+// Points `f` at the fingerprints of the image at `image`, without copying, the image must outlive `f`. Returns
+// false if `image` is not a whole filter image.
+static inline bool museair_fuse_load(museair_fuse_t* f, const void* image, const size_t size) {
+    const uint8_t* p = (const uint8_t*)image;
+    if (size < MUSEAIR_FUSE_HEADER || memcmp(p, MUSEAIR_FUSE_MAGIC, 8) != 0) {
+        return false;
+    }
+    museair_fuse_t g;
+    memset(&g, 0, sizeof(g));
+    g.seed = _museair_read_u64(p + 8);
+    g.segment_length = (uint32_t)_museair_read_u32(p + 16);
+    g.segment_count_length = (uint32_t)_museair_read_u32(p + 20);
+    g.array_length = (uint32_t)_museair_read_u32(p + 24);
+    if (g.segment_length == 0 || (g.segment_length & (g.segment_length - 1)) != 0 ||
+        g.segment_count_length % g.segment_length != 0 || g.segment_count_length == 0 ||
+        (uint64_t)g.array_length != (uint64_t)g.segment_count_length + 2 * (uint64_t)g.segment_length ||
+        size - MUSEAIR_FUSE_HEADER != g.array_length) {
+        return false;
+    }
+    g.fingerprints = p + MUSEAIR_FUSE_HEADER;
+    *f = g;
+    return true;
+}
+
+#endif  // MUSEAIR_FUSE_H
@@ -0,0 +1,564 @@
+/*
+ * Minimal perfect hash functions over MuseAir digests, built in parallel, a few bits per key.
+ *
+ * SPDX-License-Identifier: Apache-2.0 OR MIT
+ *
+ * Follows PTHash ("PTHash: Revisiting FCH Minimal Perfect Hashing", Pibiri and Trani, 2021), partitioned. A key is
+ * hashed once with `museair_hash_128(key, len, seed)`. The lower half picks a partition of about
+ * `MUSEAIR_MPHF_PARTITION` keys, then one of its buckets, skewed so that 60% of the keys fall into 30% of the
+ * buckets. Each bucket stores a pilot, found at build time, such that the upper half mixed with a hash of the pilot
+ * and reduced to the partition's table, 1% larger than the partition, puts every key of the bucket on a free slot.
+ * Keys landing past the partition's key count are remapped to the slots left free before it. Functions take about
+ * 2.5 bits per key.
+ *
+ * A lookup is one hash, one read of the pilot, and for 1% of the keys a read of the remap table; the partition
+ * table is small enough to stay in cache. Pilots are stored with a fixed width, the few too large for it in a
+ * sorted exception list that costs a binary search.
+ *
+ * `museair_mphf_build` hashes the keys, spreads them over partitions and builds the partitions on `threads` POSIX
+ * threads, define `MUSEAIR_MPHF_NO_THREADS` to leave threads out. It needs about 16 bytes per key. Keys must be
+ * distinct, a build fails on duplicates. The function does not depend on the thread count.
+ *
+ * The built function is its image. After `MUSEAIR_MPHF_MAGIC` come the seed, key count, partition count, buckets
+ * per partition, pilot and remap widths in bits as two 32-bit words, exception count and remap entry count. Then the
+ * partitions (first key, then key count and first remap entry as two 32-bit words, 16 bytes each), the pilots as a
+ * bit string, the exceptions (bucket index `<< 24 |` pilot, 8 bytes each) and the remap entries as a bit string.
+ */
+
+#ifndef MUSEAIR_MPHF_H
+#define MUSEAIR_MPHF_H
+
+#include "museair.h"
+
+#include <stdlib.h>
+#ifndef MUSEAIR_MPHF_NO_THREADS
+    #include <pthread.h>
+    #include <unistd.h>
+#endif
+
+#define MUSEAIR_MPHF_MAGIC "MusePth1"
+#define MUSEAIR_MPHF_HEADER 64
+#ifndef MUSEAIR_MPHF_PARTITION
+    #define MUSEAIR_MPHF_PARTITION ((size_t)1 << 20)  // keys per partition, at least, unless there is only one.
+#endif
+#define MUSEAIR_MPHF_BUCKET_SIZE 5  // average keys per bucket, larger makes smaller functions that build slower.
+#define MUSEAIR_MPHF_SLACK 99       // tables are `1 + 1 / MUSEAIR_MPHF_SLACK` times as large as their partitions.
+#define MUSEAIR_MPHF_ATTEMPTS 4
+#define MUSEAIR_MPHF_MAX_PILOT (UINT32_C(1) << 24)
+
+typedef struct {
+    uint64_t seed;
+    uint64_t n;
+    uint64_t partitions;
+    uint64_t buckets;  // per partition.
+    uint32_t pilot_bits;
+    uint32_t remap_bits;
+    uint64_t exceptions;  // pilots too large for `pilot_bits`.
+    uint64_t remap_entries;
+    uint64_t dense_buckets;  // buckets taking 60% of the keys, and the scales mapping hashes onto them and the rest.
+    uint64_t dense_scale;
+    uint64_t sparse_scale;
+    const uint8_t* parts;
+    const uint8_t* pilots;
+    const uint8_t* exception_list;
+    const uint8_t* remap;
+    size_t size;  // of the image.
+    void* mem;    // allocation behind the image, NULL for a loaded one.
+} museair_mphf_t;
+
+/*----------------------------------------------------------------------------*/
+
+#define _MUSEAIR_MPHF_DENSE UINT64_C(0x9999999999999999)  // 60% of the hash range.
+
+static FORCE_INLINE uint64_t _museair_mphf_table(uint64_t keys) {
+    return keys + (keys + MUSEAIR_MPHF_SLACK - 1) / MUSEAIR_MPHF_SLACK;
+}
+
+static FORCE_INLINE uint64_t _museair_mphf_bucket(const museair_mphf_t* f, uint64_t frac) {
+    uint64_t unused, bucket;
+    if (frac < _MUSEAIR_MPHF_DENSE) {
+        _museair_wmul(&unused, &bucket, frac, f->dense_scale);
+        return bucket;
+    }
+    _museair_wmul(&unused, &bucket, frac - _MUSEAIR_MPHF_DENSE, f->sparse_scale);
+    return f->dense_buckets + bucket;
+}
+
+static FORCE_INLINE uint64_t _museair_mphf_pilot_hash(uint64_t pilot, uint64_t seed) {
+    uint64_t lo, hi;
+    _museair_wmul(&lo, &hi, pilot ^ seed ^ UINT64_C(0x5851f42d4c957f2d), UINT64_C(0x9E3779B97F4A7C15));
+    return lo ^ hi;
+}
+
+// Mixes before reducing, or keys whose digests share their top bits would share their slot under every pilot.
+static FORCE_INLINE uint64_t _museair_mphf_slot(uint64_t hi, uint64_t pilot_hash, uint64_t table) {
+    uint64_t lo, unused, slot;
+    _museair_wmul(&lo, &hi, hi ^ pilot_hash, UINT64_C(0xbea225f9eb34556d));
+    _museair_wmul(&unused, &slot, lo ^ hi, table);
+    return slot;
+}
+
+// Reads `width` bits (at most 56) at `bit` of a bit string.
+static FORCE_INLINE uint64_t _museair_mphf_bits(const uint8_t* p, uint64_t bit, uint32_t width) {
+    return (_museair_read_u64(p + (bit >> 3)) >> (bit & 7)) & ((UINT64_C(1) << width) - 1);
+}
+
+static inline void _museair_mphf_put_bits(uint8_t* p, uint64_t bit, uint64_t v) {
+    _museair_write_u64(p + (bit >> 3), _museair_read_u64(p + (bit >> 3)) | v << (bit & 7));
+}
+
+static inline void _museair_mphf_derive(museair_mphf_t* f) {
+    f->dense_buckets = f->buckets * 3 / 10;
+    f->dense_scale = f->dense_buckets * 10 / 6;
+    f->sparse_scale = (f->buckets - f->dense_buckets) * 5 / 2 - 1;
+}
+
+// Sets the shape of a function of `n` keys, and its bucket mapping.
+static inline void _museair_mphf_shape(museair_mphf_t* f, const uint64_t n) {
+    f->n = n;
+    f->partitions = n / MUSEAIR_MPHF_PARTITION ? n / MUSEAIR_MPHF_PARTITION : 1;
+    f->buckets = n / f->partitions / MUSEAIR_MPHF_BUCKET_SIZE + 1;
+    _museair_mphf_derive(f);
+}
+
+static FORCE_INLINE uint64_t _museair_mphf_bytes(uint64_t entries, uint32_t width) {
+    return ((entries * width + 7) / 8 + 15) & ~(uint64_t)7;  // padded for 64-bit reads of the last entries.
+}
+
+// Sets the image size of `f` from its shape and widths.
+static inline void _museair_mphf_layout(museair_mphf_t* f) {
+    const uint64_t pilot_bytes = _museair_mphf_bytes(f->partitions * f->buckets, f->pilot_bits);
+    const uint64_t remap_bytes = _museair_mphf_bytes(f->remap_entries, f->remap_bits);
+    f->size = (size_t)(MUSEAIR_MPHF_HEADER + f->partitions * 16 + pilot_bytes + f->exceptions * 8 + remap_bytes);
+}
+
+// Points the arrays of `f` into `image`.
+static inline void _museair_mphf_place(museair_mphf_t* f, const uint8_t* image) {
+    f->parts = image + MUSEAIR_MPHF_HEADER;
+    f->pilots = f->parts + f->partitions * 16;
+    f->exception_list = f->pilots + _museair_mphf_bytes(f->partitions * f->buckets, f->pilot_bits);
+    f->remap = f->exception_list + f->exceptions * 8;
+}
+
+// Pilot of bucket `index` past the escape value, from the exception list.
+static inline uint64_t _museair_mphf_exception(const museair_mphf_t* f, uint64_t index) {
+    uint64_t lo = 0, hi = f->exceptions;
+    while (hi - lo > 1) {
+        const uint64_t mid = (lo + hi) / 2;
+        lo = _museair_read_u64(f->exception_list + mid * 8) >> 24 <= index ? mid : lo;
+        hi = _museair_read_u64(f->exception_list + mid * 8) >> 24 <= index ? hi : mid;
+    }
+    return _museair_read_u64(f->exception_list + lo * 8) & 0xffffff;
+}
+
+/*----------------------------------------------------------------------------*/
+
+#define _MUSEAIR_MPHF_CHUNK ((size_t)1 << 16)
+
+typedef struct {
+    const void* const* keys;
+    const size_t* lens;
+    museair_mphf_t shape;
+    size_t chunk;
+    size_t chunks;
+    int phase;   // 0 counts the keys of each chunk and partition, 1 scatters their digests, 2 builds partitions.
+    size_t next;  // next chunk or partition to claim, shared by all workers.
+    int failed;
+    uint64_t* offsets;  // of each chunk in each partition.
+    uint64_t* starts;   // first key of each partition, then `n`.
+    uint64_t* remap_starts;
+    uint64_t* digests;  // by partition.
+    uint32_t* pilots;
+    uint32_t* remap;
+} _museair_mphf_job_t;
+
+static inline void _museair_mphf_spread(_museair_mphf_job_t* job, size_t c) {
+    const museair_mphf_t* f = &job->shape;
+    const size_t begin = c * job->chunk, end = f->n - begin < job->chunk ? f->n : begin + job->chunk;
+    uint64_t digests[2 * 64], unused, part;
+    uint64_t* offsets = job->offsets + c * f->partitions;
+    for (size_t b = begin; b < end; b += 64) {
+        const size_t m = end - b < 64 ? end - b : 64;
+        _museair_hash_batch(false, true, job->keys + b, job->lens + b, m, f->seed, digests);
+        for (size_t l = 0; l < m; l++) {
+            _museair_wmul(&unused, &part, digests[2 * l], f->partitions);
+            if (job->phase == 0) {
+                offsets[part]++;
+            } else {
+                memcpy(&job->digests[2 * offsets[part]++], &digests[2 * l], 16);
+            }
+        }
+    }
+}
+
+// Finds the pilots of partition `p`, biggest buckets first, then remaps the slots past its keys.
+static inline bool _museair_mphf_partition(_museair_mphf_job_t* job, size_t p) {
+    const museair_mphf_t* f = &job->shape;
+    const uint64_t* digests = job->digests + 2 * job->starts[p];
+    const size_t n = (size_t)(job->starts[p + 1] - job->starts[p]), m = (size_t)f->buckets;
+    const uint64_t table = _museair_mphf_table(n);
+    uint32_t* bucket_of = (uint32_t*)malloc((n + 1) * sizeof(uint32_t));
+    uint32_t* sorted = (uint32_t*)malloc((n + 1) * sizeof(uint32_t));
+    uint32_t* start = (uint32_t*)calloc(m + 2, sizeof(uint32_t));
+    uint32_t* order = (uint32_t*)malloc(m * sizeof(uint32_t));
+    uint64_t* taken = (uint64_t*)calloc(table / 64 + 1, sizeof(uint64_t));
+    uint64_t* slots = (uint64_t*)malloc((n + 1) * sizeof(uint64_t));
+    bool ok = bucket_of && sorted && start && order && taken && slots;
+
+    // Sorts keys by bucket, then buckets by size.
+    size_t largest = 0;
+    for (size_t i = 0; ok && i < n; i++) {
+        uint64_t frac, unused;
+        _museair_wmul(&frac, &unused, digests[2 * i], f->partitions);
+        bucket_of[i] = (uint32_t)_museair_mphf_bucket(f, frac);
+        start[bucket_of[i] + 2]++;
+    }
+    for (size_t b = 0; ok && b < m; b++) {
+        largest = start[b + 2] > largest ? start[b + 2] : largest;
+        start[b + 2] += start[b + 1];
+    }
+    for (size_t i = 0; ok && i < n; i++) {
+        sorted[start[bucket_of[i] + 1]++] = (uint32_t)i;
+    }
+    uint32_t* by_size = (uint32_t*)calloc(largest + 2, sizeof(uint32_t));
+    ok &= by_size != NULL;
+    for (size_t b = 0; ok && b < m; b++) {
+        by_size[largest - (start[b + 1] - start[b])]++;
+    }
+    for (size_t s = 1; ok && s <= largest; s++) {
+        by_size[s] += by_size[s - 1];
+    }
+    for (size_t b = m; ok && b-- > 0;) {
+        order[--by_size[largest - (start[b + 1] - start[b])]] = (uint32_t)b;
+    }
+
+    for (size_t o = 0; ok && o < m; o++) {
+        const uint32_t b = order[o], size = start[b + 1] - start[b];
+        const uint32_t* keys = sorted + start[b];
+        for (uint32_t i = 0; i < size; i++) {
+            for (uint32_t j = 0; j < i; j++) {
+                ok &= digests[2 * keys[i] + 1] != digests[2 * keys[j] + 1];
+            }
+        }
+        uint32_t pilot = 0;
+        for (; ok && pilot < MUSEAIR_MPHF_MAX_PILOT; pilot++) {
+            const uint64_t h = _museair_mphf_pilot_hash(pilot, f->seed);
+            uint32_t i = 0;
+            for (; i < size; i++) {
+                const uint64_t slot = slots[i] = _museair_mphf_slot(digests[2 * keys[i] + 1], h, table);
+                bool clash = (taken[slot >> 6] >> (slot & 63)) & 1;
+                for (uint32_t j = 0; j < i; j++) {
+                    clash |= slots[j] == slot;
+                }
+                if (clash) {
+                    break;
+                }
+            }
+            if (i == size) {
+                break;
+            }
+        }
+        ok &= pilot < MUSEAIR_MPHF_MAX_PILOT;
+        for (uint32_t i = 0; ok && i < size; i++) {
+            taken[slots[i] >> 6] |= UINT64_C(1) << (slots[i] & 63);
+        }
+        job->pilots[p * m + b] = pilot;
+    }
+
+    // Pairs the taken slots past `n` with the free ones before, in order.
+    uint32_t* remap = job->remap + job->remap_starts[p];
+    for (uint64_t free_slot = 0, slot = n; ok && slot < table; slot++) {
+        if ((taken[slot >> 6] >> (slot & 63)) & 1) {
+            while ((taken[free_slot >> 6] >> (free_slot & 63)) & 1) {
+                free_slot++;
+            }
+            remap[slot - n] = (uint32_t)free_slot++;
+        }
+    }
+    free(by_size);
+    free(slots);
+    free(taken);
+    free(order);
+    free(start);
+    free(sorted);
+    free(bucket_of);
+    return ok;
+}
+
+static void* _museair_mphf_worker(void* arg) {
+    _museair_mphf_job_t* job = (_museair_mphf_job_t*)arg;
+    const size_t count = job->phase < 2 ? job->chunks : (size_t)job->shape.partitions;
+    for (;;) {
+#ifndef MUSEAIR_MPHF_NO_THREADS
+        size_t c = __atomic_fetch_add(&job->next, 1, __ATOMIC_RELAXED);
+#else
+        size_t c = job->next++;
+#endif
+        if (c >= count) {
+            return NULL;
+        }
+        if (job->phase < 2) {
+            _museair_mphf_spread(job, c);
+        } else if (!_museair_mphf_partition(job, c)) {
+#ifndef MUSEAIR_MPHF_NO_THREADS
+            __atomic_store_n(&job->failed, 1, __ATOMIC_RELAXED);
+#else
+            job->failed = 1;
+#endif
+        }
+    }
+}
+
+static inline void _museair_mphf_run(_museair_mphf_job_t* job, int phase, int threads) {
+    job->phase = phase;
+    job->next = 0;
+#ifndef MUSEAIR_MPHF_NO_THREADS
+    pthread_t* pool = threads > 1 ? (pthread_t*)malloc(sizeof(pthread_t) * (size_t)threads) : NULL;
+    int spawned = 0;
+    while (pool && spawned < threads - 1 && pthread_create(&pool[spawned], NULL, _museair_mphf_worker, job) == 0) {
+        spawned++;
+    }
+    _museair_mphf_worker(job);
+    for (int n = 0; n < spawned; n++) {
+        pthread_join(pool[n], NULL);
+    }
+    free(pool);
+#else
+    (void)threads;
+    _museair_mphf_worker(job);
+#endif
+}
+
+static inline uint32_t _museair_mphf_width(uint64_t max) {
+    uint32_t bits = 0;
+    while (max >> bits) {
+        bits++;
+    }
+    return bits;
+}
+
+// One build attempt with `job->shape.seed`, into a new image.
+static inline bool _museair_mphf_attempt(museair_mphf_t* f, _museair_mphf_job_t* job, int threads) {
+    const museair_mphf_t* s = &job->shape;
+    const size_t parts = (size_t)s->partitions;
+    memset(job->offsets, 0, job->chunks * parts * sizeof(uint64_t));
+    _museair_mphf_run(job, 0, threads);
+
+    // Partitions are laid out in order, each with its keys in chunk order.
+    uint64_t at = 0, remap_at = 0;
+    for (size_t p = 0; p < parts; p++) {
+        job->starts[p] = at;
+        job->remap_starts[p] = remap_at;
+        for (size_t c = 0; c < job->chunks; c++) {
+            const uint64_t count = job->offsets[c * parts + p];
+            job->offsets[c * parts + p] = at;
+            at += count;
+        }
+        remap_at += _museair_mphf_table(at - job->starts[p]) - (at - job->starts[p]);
+    }
+    job->starts[parts] = at;
+    job->remap_starts[parts] = remap_at;
+    job->remap = (uint32_t*)malloc((remap_at + 1) * sizeof(uint32_t));
+    if (!job->remap) {
+        return false;
+    }
+    memset(job->remap, 0, (remap_at + 1) * sizeof(uint32_t));
+    _museair_mphf_run(job, 1, threads);
+    job->failed = 0;
+    _museair_mphf_run(job, 2, threads);
+    if (job->failed) {
+        free(job->remap);
+        return false;
+    }
+
+    // Pilots take the width that minimizes the size, an escape value sends the larger ones to a sorted exception list.
+    *f = *s;
+    const size_t pilots = parts * (size_t)s->buckets;
+    uint64_t histogram[26] = {0}, fits = 0, best = UINT64_MAX;
+    for (size_t i = 0; i < pilots; i++) {
+        histogram[_museair_mphf_width(job->pilots[i] + 1)]++;
+    }
+    for (uint32_t w = 1; w <= 25; w++) {
+        fits += histogram[w];
+        if (pilots * w + (pilots - fits) * 64 < best) {
+            best = pilots * w + (pilots - fits) * 64;
+            f->pilot_bits = w;
+            f->exceptions = pilots - fits;
+        }
+    }
+    uint32_t max_keys = 0;
+    for (size_t p = 0; p < parts; p++) {
+        const uint64_t keys = job->starts[p + 1] - job->starts[p];
+        max_keys = keys > max_keys ? (uint32_t)keys : max_keys;
+    }
+    f->remap_bits = _museair_mphf_width(max_keys ? max_keys - 1 : 0);
+    f->remap_entries = remap_at;
+    _museair_mphf_layout(f);
+    uint8_t* image = (uint8_t*)calloc(f->size, 1);
+    if (image) {
+        memcpy(image, MUSEAIR_MPHF_MAGIC, 8);
+        _museair_write_u64(image + 8, f->seed);
+        _museair_write_u64(image + 16, f->n);
+        _museair_write_u64(image + 24, f->partitions);
+        _museair_write_u64(image + 32, f->buckets);
+        _museair_write_u64(image + 40, (uint64_t)f->remap_bits << 32 | f->pilot_bits);
+        _museair_write_u64(image + 48, f->exceptions);
+        _museair_write_u64(image + 56, f->remap_entries);
+        _museair_mphf_place(f, image);
+        uint8_t* part = (uint8_t*)(uintptr_t)f->parts;
+        for (size_t p = 0; p < parts; p++) {
+            const uint64_t keys = job->starts[p + 1] - job->starts[p];
+            _museair_write_u64(part + p * 16, job->starts[p]);
+            _museair_write_u64(part + p * 16 + 8, job->remap_starts[p] << 32 | keys);
+        }
+        const uint32_t escape = (UINT32_C(1) << f->pilot_bits) - 1;
+        uint8_t* exception = (uint8_t*)(uintptr_t)f->exception_list;
+        for (size_t i = 0; i < pilots; i++) {
+            _museair_mphf_put_bits((uint8_t*)(uintptr_t)f->pilots, i * f->pilot_bits,
+                                   job->pilots[i] < escape ? job->pilots[i] : escape);
+            if (job->pilots[i] >= escape) {
+                _museair_write_u64(exception, (uint64_t)i << 24 | job->pilots[i]);
+                exception += 8;
+            }
+        }
+        for (size_t i = 0; i < remap_at; i++) {
+            _museair_mphf_put_bits((uint8_t*)(uintptr_t)f->remap, i * f->remap_bits, job->remap[i]);
+        }
+    }
+    f->mem = image;
+    free(job->remap);
+    return image != NULL;
+}
+
+/*----------------------------------------------------------------------------*/
+
+// Builds a minimal perfect hash function of the `n` distinct keys, on `threads` threads (0 for one per online
+// CPU). `seed` is the first seed tried. Returns false if out of memory or if every attempt failed, which takes
+// duplicate keys.
+static inline bool museair_mphf_build(museair_mphf_t* f,
+                                      const void* const* keys,
+                                      const size_t* lens,
+                                      const size_t n,
+                                      const uint64_t seed,
+                                      int threads) {
+    memset(f, 0, sizeof(*f));
+    _museair_mphf_job_t job;
+    memset(&job, 0, sizeof(job));
+    job.keys = keys;
+    job.lens = lens;
+    _museair_mphf_shape(&job.shape, n);
+#ifndef MUSEAIR_MPHF_NO_THREADS
+    if (threads <= 0) {
+        long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+        threads = cpus > 0 ? (int)cpus : 1;
+    }
+#endif
+    const size_t parts = (size_t)job.shape.partitions;
+    job.chunk = n / 1024 > _MUSEAIR_MPHF_CHUNK ? n / 1024 : _MUSEAIR_MPHF_CHUNK;
+    job.chunks = n / job.chunk + 1;
+    job.offsets = (uint64_t*)malloc(job.chunks * parts * sizeof(uint64_t));
+    job.starts = (uint64_t*)malloc((parts + 1) * sizeof(uint64_t));
+    job.remap_starts = (uint64_t*)malloc((parts + 1) * sizeof(uint64_t));
+    job.digests = (uint64_t*)malloc((2 * n + 1) * sizeof(uint64_t));
+    job.pilots = (uint32_t*)malloc(parts * (size_t)job.shape.buckets * sizeof(uint32_t));
+    bool ok = false;
+    if (job.offsets && job.starts && job.remap_starts && job.digests && job.pilots) {
+        for (int attempt = 0; !ok && attempt < MUSEAIR_MPHF_ATTEMPTS; attempt++) {
+            job.shape.seed = seed + (uint64_t)attempt;
+            ok = _museair_mphf_attempt(f, &job, threads);
+        }
+    }
+    free(job.pilots);
+    free(job.digests);
+    free(job.remap_starts);
+    free(job.starts);
+    free(job.offsets);
+    if (!ok) {
+        memset(f, 0, sizeof(*f));
+    }
+    return ok;
+}
+
+static inline void museair_mphf_free(museair_mphf_t* f) {
+    free(f->mem);
+    memset(f, 0, sizeof(*f));
+}
+
+// Returns the index of `key` in `0 .. n - 1` if it was one of the keys, an arbitrary index otherwise.
+static inline uint64_t museair_mphf_lookup(const museair_mphf_t* f, const void* key, const size_t len) {
+    uint64_t hi, lo = museair_hash_128(key, len, f->seed, &hi);
+    uint64_t frac, part;
+    _museair_wmul(&frac, &part, lo, f->partitions);
+    const uint64_t first = _museair_read_u64(f->parts + part * 16);
+    const uint64_t keys = _museair_read_u32(f->parts + part * 16 + 8);
+    const uint64_t bucket = _museair_mphf_bucket(f, frac);
+    const uint64_t index = part * f->buckets + bucket, escape = (UINT64_C(1) << f->pilot_bits) - 1;
+    uint64_t pilot = _museair_mphf_bits(f->pilots, index * f->pilot_bits, f->pilot_bits);
+    if (_museair_unlikely(pilot == escape)) {
+        pilot = _museair_mphf_exception(f, index);
+    }
+    const uint64_t slot = _museair_mphf_slot(hi, _museair_mphf_pilot_hash(pilot, f->seed), _museair_mphf_table(keys));
+    if (_museair_likely(slot < keys)) {
+        return first + slot;
+    }
+    const uint64_t remap = _museair_read_u32(f->parts + part * 16 + 12) + slot - keys;
+    return first + _museair_mphf_bits(f->remap, remap * f->remap_bits, f->remap_bits);
+}
+
+static inline size_t museair_mphf_image_size(const museair_mphf_t* f) {
+    return f->size;
+}
+
+// Writes the image of `f` to `museair_mphf_image_size(f)` bytes at `image`.
+static inline void museair_mphf_save(const museair_mphf_t* f, void* image) {
+    memcpy(image, f->parts - MUSEAIR_MPHF_HEADER, f->size);
+}
+
+// Points `f` at the image at `image`, without copying, the image must outlive `f`. Returns false if `image` is not
+// a whole function image.
+static inline bool museair_mphf_load(museair_mphf_t* f, const void* image, const size_t size) {
+    const uint8_t* p = (const uint8_t*)image;
+    if (size < MUSEAIR_MPHF_HEADER || memcmp(p, MUSEAIR_MPHF_MAGIC, 8) != 0) {
+        return false;
+    }
+    museair_mphf_t g;
+    memset(&g, 0, sizeof(g));
+    g.seed = _museair_read_u64(p + 8);
+    g.n = _museair_read_u64(p + 16);
+    g.partitions = _museair_read_u64(p + 24);
+    g.buckets = _museair_read_u64(p + 32);
+    g.pilot_bits = (uint32_t)_museair_read_u32(p + 40);
+    g.remap_bits = (uint32_t)_museair_read_u32(p + 44);
+    g.exceptions = _museair_read_u64(p + 48);
+    g.remap_entries = _museair_read_u64(p + 56);
+    // Bounds every count first, so that the size computed from them cannot overflow.
+    if (g.partitions == 0 || g.partitions > size / 16 || g.buckets == 0 || g.buckets > size * 8 ||
+        g.pilot_bits == 0 || g.pilot_bits > 25 || g.remap_bits > 32 || g.exceptions > size / 8 ||
+        g.remap_entries > size * 8 || g.buckets > size * 8 / g.partitions) {
+        return false;
+    }
+    _museair_mphf_layout(&g);
+    if (g.size != size) {
+        return false;
+    }
+    _museair_mphf_derive(&g);
+    _museair_mphf_place(&g, p);
+    // Partitions must tile the keys in order, and keep their remap entries within the remap table.
+    uint64_t at = 0;
+    for (uint64_t part = 0; part < g.partitions; part++) {
+        const uint64_t keys = _museair_read_u32(g.parts + part * 16 + 8);
+        const uint64_t remap = _museair_read_u32(g.parts + part * 16 + 12);
+        if (_museair_read_u64(g.parts + part * 16) != at ||
+            remap + _museair_mphf_table(keys) - keys > g.remap_entries) {
+            return false;
+        }
+        at += keys;
+    }
+    if (at != g.n) {
+        return false;
+    }
+    *f = g;
+    return true;
+}
+
+#endif  // MUSEAIR_MPHF_H
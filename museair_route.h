@@ -0,0 +1,377 @@
+/*
+ * Consistent hashing over MuseAir digests: jump hash, Maglev tables and weighted rendezvous hashing. Link with `-lm`.
+ *
+ * SPDX-License-Identifier: Apache-2.0 OR MIT
+ *
+ * Three ways to route keys to nodes so that few keys move when nodes come and go, all hashing a key once with
+ * `museair_hash(key, len, seed)`:
+ *
+ * - Jump consistent hash ("A Fast, Minimal Memory, Consistent Hash Algorithm", Lamping and Veach, 2014) needs no
+ *   state, but nodes are numbered `0 .. n - 1` and only the last one can leave. Growing from `n` to `n + 1` nodes
+ *   moves `1 / (n + 1)` of the keys, all of them to the new node. A lookup takes about `ln(n)` steps.
+ *
+ * - A Maglev table ("Maglev: A Fast and Reliable Software Network Load Balancer", Eisenbud et al., 2016) is a prime
+ *   number of entries, about 100 per node, each naming a node, and a lookup is one read of the entry the digest
+ *   reduces to. Every node has its own permutation of the entries, an offset and a skip taken from
+ *   `museair_hash_128` of its name, and the nodes take turns claiming the next free entry of their permutation, so
+ *   that they end up with the same number of entries give or take one. `museair_maglev_rebuild` refills the table
+ *   from the permutations kept from the build for any subset of nodes that are up: keys of a node that goes down
+ *   spread evenly over the others, and several times as many other keys move between them.
+ *
+ * - Weighted rendezvous hashing ("Weighted Distributed Hash Tables", Schindelhauer and Schomaker, 2005) sends a key
+ *   to the node of lowest score `-ln(1 - u) / w`, `u` a uniform hash of the key's digest and the node's name and `w`
+ *   the node's weight. The scores are exponential variables of rate `w`, so nodes take keys in proportion to their
+ *   weights, and changing a weight only moves keys to or from that node. A lookup scores every node: as
+ *   `-ln(1 - u) >= u`, `u / w` is a lower bound computed with two multiplies, four nodes at a time with AVX2, and
+ *   the logarithm is only taken for the nodes whose bound beats the best score so far, about `ln(n)` of them. The
+ *   bound only screens nodes, builds with and without AVX2 route keys alike.
+ *
+ * Maglev tables and rendezvous sets are not thread-safe for rebuilds and weight changes, concurrent lookups are fine.
+ */
+
+#ifndef MUSEAIR_ROUTE_H
+#define MUSEAIR_ROUTE_H
+
+#include "museair.h"
+
+#include <float.h>
+#include <math.h>
+#include <stdlib.h>
+#if defined(__AVX2__)
+    #include <immintrin.h>
+#endif
+
+#define MUSEAIR_ROUTE_BATCH 16      // keys per digest buffer in the batch functions.
+#define MUSEAIR_MAGLEV_PER_NODE 100  // entries per node of `museair_maglev_size_for`.
+
+typedef struct {
+    uint64_t seed;
+    uint64_t size;      // entries, a prime.
+    size_t n;           // nodes.
+    uint32_t* table;    // `size` node indexes, `UINT32_MAX` where no node is up.
+    uint32_t* perms;    // offset and skip of each node's permutation.
+    uint32_t* scratch;  // nodes up and their next entries, for rebuilds.
+} museair_maglev_t;
+
+typedef struct {
+    uint64_t seed;
+    size_t n;           // nodes, the arrays are padded to a multiple of 4.
+    uint64_t* hashes;   // `museair_hash` of the node names.
+    double* weights;
+    double* inverses;   // `1 / weight`, infinity for nodes of weight 0, which take no keys.
+} museair_rendezvous_t;
+
+/*----------------------------------------------------------------------------*/
+
+#define _MUSEAIR_RENDEZVOUS_SLACK (1.0 + 1.0 / 1099511627776.0)  // 2^-40 of margin over the lower bounds' rounding.
+
+static inline bool _museair_maglev_prime(uint64_t v) {
+    if (v < 4) {
+        return v >= 2;
+    }
+    if (v % 2 == 0 || v % 3 == 0) {
+        return false;
+    }
+    for (uint64_t d = 5; d * d <= v; d += 6) {
+        if (v % d == 0 || v % (d + 2) == 0) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// Fills the table with the nodes of `up`, all of them if NULL. The next entry of each node is prefetched a few turns
+// ahead, the first probes of a round miss the cache otherwise.
+static inline void _museair_maglev_fill(museair_maglev_t* m, const bool* up) {
+    const uint32_t size = (uint32_t)m->size;
+    uint32_t *nodes = m->scratch, *next = m->scratch + m->n, live = 0;
+    for (size_t i = 0; i < m->n; i++) {
+        if (!up || up[i]) {
+            nodes[live] = (uint32_t)i;
+            next[live++] = m->perms[2 * i];
+        }
+    }
+    memset(m->table, 0xff, (size_t)size * sizeof(uint32_t));
+    if (live == 0) {
+        return;
+    }
+    for (uint32_t filled = 0;;) {
+        for (uint32_t k = 0; k < live; k++) {
+            if (k + 8 < live) {
+                _museair_prefetch(&m->table[next[k + 8]], 0);
+            }
+            const uint32_t node = nodes[k], skip = m->perms[2 * node + 1];
+            uint32_t c = next[k];
+            while (m->table[c] != UINT32_MAX) {
+                c = c >= size - skip ? c - (size - skip) : c + skip;
+            }
+            m->table[c] = node;
+            next[k] = c >= size - skip ? c - (size - skip) : c + skip;
+            if (++filled == size) {
+                return;
+            }
+        }
+    }
+}
+
+// A uniform hash of a key's digest and a node's, the Moremur finalizer of their xor.
+static FORCE_INLINE uint64_t _museair_rendezvous_mix(uint64_t key, uint64_t node) {
+    uint64_t x = key ^ node;
+    x = (x ^ (x >> 27)) * UINT64_C(0x3C79AC492BA7B653);
+    x = (x ^ (x >> 33)) * UINT64_C(0x1C69B3F74AC4AE35);
+    return x ^ (x >> 27);
+}
+
+// `u` of a mix, in the middle of one of 2^52 equal steps of `(0, 1)`.
+static FORCE_INLINE double _museair_rendezvous_uniform(uint64_t x) {
+    return ((double)(x >> 12) + 0.5) * DBL_EPSILON;
+}
+
+#if defined(__AVX2__)
+static FORCE_INLINE __m256i _museair_rendezvous_mul4(__m256i a, uint64_t c) {
+    const __m256i lo = _mm256_set1_epi64x((long long)(c & 0xffffffff)), hi = _mm256_set1_epi64x((long long)(c >> 32));
+    __m256i cross = _mm256_add_epi64(_mm256_mul_epu32(_mm256_srli_epi64(a, 32), lo), _mm256_mul_epu32(a, hi));
+    return _mm256_add_epi64(_mm256_mul_epu32(a, lo), _mm256_slli_epi64(cross, 32));
+}
+
+static FORCE_INLINE __m256i _museair_rendezvous_mix4(__m256i key, __m256i node) {
+    __m256i x = _mm256_xor_si256(key, node);
+    x = _museair_rendezvous_mul4(_mm256_xor_si256(x, _mm256_srli_epi64(x, 27)), UINT64_C(0x3C79AC492BA7B653));
+    x = _museair_rendezvous_mul4(_mm256_xor_si256(x, _mm256_srli_epi64(x, 33)), UINT64_C(0x1C69B3F74AC4AE35));
+    return _mm256_xor_si256(x, _mm256_srli_epi64(x, 27));
+}
+#endif
+
+// Takes node `i` if its score beats `*best`, and tightens the screening threshold.
+static FORCE_INLINE void _museair_rendezvous_score(
+    const museair_rendezvous_t* r, uint64_t hash, size_t i, double* best, double* threshold, int32_t* node) {
+    const double u = _museair_rendezvous_uniform(_museair_rendezvous_mix(hash, r->hashes[i]));
+    const double score = -log1p(-u) / r->weights[i];
+    if (score < *best) {
+        *best = score;
+        *threshold = score * _MUSEAIR_RENDEZVOUS_SLACK;
+        *node = (int32_t)i;
+    }
+}
+
+/*----------------------------------------------------------------------------*/
+
+// Jump consistent hash of a digest onto `0 .. buckets - 1`, -1 if there are none.
+static inline int32_t museair_jump(uint64_t hash, const int32_t buckets) {
+    int64_t b = -1, j = 0;
+    while (j < buckets) {
+        b = j;
+        hash = hash * UINT64_C(2862933555777941757) + 1;
+        j = (int64_t)((double)(b + 1) * ((double)(INT64_C(1) << 31) / (double)((hash >> 33) + 1)));
+    }
+    return (int32_t)b;
+}
+
+static inline int32_t museair_jump_hash(const void* key, const size_t len, const uint64_t seed, const int32_t buckets) {
+    return museair_jump(museair_hash(key, len, seed), buckets);
+}
+
+static inline void museair_jump_batch(const void* const* keys,
+                                      const size_t* lens,
+                                      const size_t n,
+                                      const uint64_t seed,
+                                      const int32_t buckets,
+                                      int32_t* out) {
+    uint64_t digests[MUSEAIR_ROUTE_BATCH];
+    for (size_t b = 0; b < n; b += MUSEAIR_ROUTE_BATCH) {
+        const size_t m = n - b < MUSEAIR_ROUTE_BATCH ? n - b : MUSEAIR_ROUTE_BATCH;
+        _museair_hash_batch(false, false, keys + b, lens + b, m, seed, digests);
+        for (size_t l = 0; l < m; l++) {
+            out[b + l] = museair_jump(digests[l], buckets);
+        }
+    }
+}
+
+/*----------------------------------------------------------------------------*/
+
+// The smallest prime of at least `MUSEAIR_MAGLEV_PER_NODE` entries per node, which keeps nodes within 1% of their
+// share of the keys.
+static inline uint64_t museair_maglev_size_for(const size_t n) {
+    uint64_t size = (uint64_t)n * MUSEAIR_MAGLEV_PER_NODE;
+    for (size = size > 2 ? size : 2; !_museair_maglev_prime(size); size++) {
+    }
+    return size;
+}
+
+// Builds a table of `size` entries, a prime of at least `n` and less than 2^32 (0 for `museair_maglev_size_for(n)`),
+// with every one of the `n` nodes up. Node `i` is named by `names[i]` and `lens[i]`, names should be distinct.
+// Returns false if there are no nodes, if `size` does not fit them or if out of memory.
+static inline bool museair_maglev_build(museair_maglev_t* m,
+                                        const void* const* names,
+                                        const size_t* lens,
+                                        const size_t n,
+                                        uint64_t size,
+                                        const uint64_t seed) {
+    memset(m, 0, sizeof(*m));
+    size = size ? size : museair_maglev_size_for(n);
+    if (n == 0 || n > INT32_MAX || size < n || size >= UINT32_MAX || !_museair_maglev_prime(size)) {
+        return false;
+    }
+    m->seed = seed;
+    m->size = size;
+    m->n = n;
+    m->table = (uint32_t*)malloc((size_t)size * sizeof(uint32_t));
+    m->perms = (uint32_t*)malloc(n * 2 * sizeof(uint32_t));
+    m->scratch = (uint32_t*)malloc(n * 2 * sizeof(uint32_t));
+    if (!m->table || !m->perms || !m->scratch) {
+        free(m->scratch), free(m->perms), free(m->table);
+        memset(m, 0, sizeof(*m));
+        return false;
+    }
+    uint64_t digests[2 * MUSEAIR_ROUTE_BATCH];
+    for (size_t b = 0; b < n; b += MUSEAIR_ROUTE_BATCH) {
+        const size_t k = n - b < MUSEAIR_ROUTE_BATCH ? n - b : MUSEAIR_ROUTE_BATCH;
+        _museair_hash_batch(false, true, names + b, lens + b, k, seed, digests);
+        for (size_t l = 0; l < k; l++) {
+            m->perms[2 * (b + l)] = (uint32_t)(digests[2 * l] % size);
+            m->perms[2 * (b + l) + 1] = (uint32_t)(digests[2 * l + 1] % (size - 1) + 1);
+        }
+    }
+    _museair_maglev_fill(m, NULL);
+    return true;
+}
+
+// Refills the table with the nodes `i` for which `up[i]` is true, all of them if `up` is NULL. The table only depends
+// on the nodes that are up, rebuilding with all of them restores the built one.
+static inline void museair_maglev_rebuild(museair_maglev_t* m, const bool* up) {
+    _museair_maglev_fill(m, up);
+}
+
+static inline void museair_maglev_free(museair_maglev_t* m) {
+    free(m->scratch), free(m->perms), free(m->table);
+    memset(m, 0, sizeof(*m));
+}
+
+// Returns the node of a digest `museair_hash(key, len, m->seed)`, -1 if no node is up.
+static inline int32_t museair_maglev_lookup_hash(const museair_maglev_t* m, const uint64_t hash) {
+    uint64_t lo, hi;
+    _museair_wmul(&lo, &hi, hash, m->size);
+    return (int32_t)m->table[hi];
+}
+
+static inline int32_t museair_maglev_lookup(const museair_maglev_t* m, const void* key, const size_t len) {
+    return museair_maglev_lookup_hash(m, museair_hash(key, len, m->seed));
+}
+
+static inline void museair_maglev_lookup_batch(const museair_maglev_t* m,
+                                               const void* const* keys,
+                                               const size_t* lens,
+                                               const size_t n,
+                                               int32_t* out) {
+    uint64_t digests[MUSEAIR_ROUTE_BATCH];
+    for (size_t b = 0; b < n; b += MUSEAIR_ROUTE_BATCH) {
+        const size_t k = n - b < MUSEAIR_ROUTE_BATCH ? n - b : MUSEAIR_ROUTE_BATCH;
+        _museair_hash_batch(false, false, keys + b, lens + b, k, m->seed, digests);
+        for (size_t l = 0; l < k; l++) {
+            uint64_t lo;
+            _museair_wmul(&lo, &digests[l], digests[l], m->size);
+            _museair_prefetch(&m->table[digests[l]], 0);
+        }
+        for (size_t l = 0; l < k; l++) {
+            out[b + l] = (int32_t)m->table[digests[l]];
+        }
+    }
+}
+
+/*----------------------------------------------------------------------------*/
+
+// Sets up `n` nodes named by `names[i]` and `lens[i]`, of weights `weights[i]`, or 1 if `weights` is NULL. Names
+// should be distinct. Returns false if out of memory.
+static inline bool museair_rendezvous_init(museair_rendezvous_t* r,
+                                          const void* const* names,
+                                          const size_t* lens,
+                                          const double* weights,
+                                          const size_t n,
+                                          const uint64_t seed) {
+    const size_t padded = (n + 3) & ~(size_t)3;
+    r->seed = seed;
+    r->n = n;
+    r->hashes = (uint64_t*)calloc(padded + 1, sizeof(uint64_t));
+    r->weights = (double*)malloc((padded + 1) * sizeof(double));
+    r->inverses = (double*)malloc((padded + 1) * sizeof(double));
+    if (!r->hashes || !r->weights || !r->inverses) {
+        free(r->inverses), free(r->weights), free(r->hashes);
+        memset(r, 0, sizeof(*r));
+        return false;
+    }
+    _museair_hash_batch(false, false, names, lens, n, seed, r->hashes);
+    for (size_t i = 0; i < padded; i++) {
+        r->weights[i] = 0;
+        r->inverses[i] = INFINITY;
+    }
+    for (size_t i = 0; i < n; i++) {
+        if (weights == NULL || weights[i] > 0) {
+            r->weights[i] = weights ? weights[i] : 1;
+            r->inverses[i] = 1 / r->weights[i];
+        }
+    }
+    return true;
+}
+
+static inline void museair_rendezvous_free(museair_rendezvous_t* r) {
+    free(r->inverses), free(r->weights), free(r->hashes);
+    memset(r, 0, sizeof(*r));
+}
+
+// Sets the weight of node `i`, 0 takes it out. Only keys of that node, or keys it takes, move.
+static inline void museair_rendezvous_set_weight(museair_rendezvous_t* r, const size_t i, const double weight) {
+    r->weights[i] = weight > 0 ? weight : 0;
+    r->inverses[i] = weight > 0 ? 1 / weight : INFINITY;
+}
+
+// Returns the node of a digest `museair_hash(key, len, r->seed)`, -1 if every weight is 0. Ties go to the first node.
+static inline int32_t museair_rendezvous_lookup_hash(const museair_rendezvous_t* r, const uint64_t hash) {
+    double best = INFINITY, threshold = INFINITY;
+    int32_t node = -1;
+    size_t i = 0;
+#if defined(__AVX2__)
+    const __m256i key = _mm256_set1_epi64x((long long)hash), bias = _mm256_set1_epi64x(0x4330000000000000);
+    const __m256d two52 = _mm256_set1_pd(4503599627370496.0), half = _mm256_set1_pd(0.5);
+    const __m256d epsilon = _mm256_set1_pd(DBL_EPSILON);
+    for (; i < r->n; i += 4) {
+        const __m256i x = _museair_rendezvous_mix4(key, _mm256_loadu_si256((const __m256i*)(r->hashes + i)));
+        // `x >> 12` as a double, exactly, through the bits of 2^52 + `x >> 12`.
+        const __m256d steps =
+            _mm256_sub_pd(_mm256_castsi256_pd(_mm256_or_si256(_mm256_srli_epi64(x, 12), bias)), two52);
+        const __m256d u = _mm256_mul_pd(_mm256_add_pd(steps, half), epsilon);
+        const __m256d bound = _mm256_mul_pd(u, _mm256_loadu_pd(r->inverses + i));
+        int lanes = _mm256_movemask_pd(_mm256_cmp_pd(bound, _mm256_set1_pd(threshold), _CMP_LT_OQ));
+        for (; lanes; lanes &= lanes - 1) {
+            _museair_rendezvous_score(r, hash, i + (size_t)_museair_ctz64((uint64_t)lanes), &best, &threshold, &node);
+        }
+    }
+#endif
+    for (; i < r->n; i++) {
+        const double u = _museair_rendezvous_uniform(_museair_rendezvous_mix(hash, r->hashes[i]));
+        if (_museair_unlikely(u * r->inverses[i] < threshold)) {
+            _museair_rendezvous_score(r, hash, i, &best, &threshold, &node);
+        }
+    }
+    return node;
+}
+
+static inline int32_t museair_rendezvous_lookup(const museair_rendezvous_t* r, const void* key, const size_t len) {
+    return museair_rendezvous_lookup_hash(r, museair_hash(key, len, r->seed));
+}
+
+static inline void museair_rendezvous_lookup_batch(const museair_rendezvous_t* r,
+                                                   const void* const* keys,
+                                                   const size_t* lens,
+                                                   const size_t n,
+                                                   int32_t* out) {
+    uint64_t digests[MUSEAIR_ROUTE_BATCH];
+    for (size_t b = 0; b < n; b += MUSEAIR_ROUTE_BATCH) {
+        const size_t k = n - b < MUSEAIR_ROUTE_BATCH ? n - b : MUSEAIR_ROUTE_BATCH;
+        _museair_hash_batch(false, false, keys + b, lens + b, k, r->seed, digests);
+        for (size_t l = 0; l < k; l++) {
+            out[b + l] = museair_rendezvous_lookup_hash(r, digests[l]);
+        }
+    }
+}
+
+#endif  // MUSEAIR_ROUTE_H
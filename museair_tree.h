@@ -0,0 +1,207 @@
+/*
+ * MuseAir tree mode, for hashing very large inputs on all cores.
+ *
+ * SPDX-License-Identifier: Apache-2.0 OR MIT
+ *
+ * NOTE: the tree digest is a distinct function of the input, it is not the `museair_hash_128` of that input.
+ *
+ * The input is cut into leaves of `MUSEAIR_TREE_CHUNK` bytes (the last one may be shorter, an empty input has a
+ * single empty leaf), each hashed with `museair_hash_128(leaf, leaf_len, seed)`. Digests are serialized as 16
+ * little-endian bytes, lower half first. Every `MUSEAIR_TREE_FANOUT` consecutive digests of a level (fewer for
+ * the last group) are concatenated and hashed with `museair_hash_128(..., seed ^ MUSEAIR_TREE_TWEAK ^ level)`
+ * into a node of the next level, until a level above the leaves has a single node, which is the tree digest.
+ *
+ * `museair_tree_hash_128_parallel` spreads the leaves over POSIX threads, define `MUSEAIR_TREE_NO_THREADS` to
+ * leave it out. `museair_tree_*` incremental functions and `museair_tree_hash_128` are the single-threaded
+ * reference, they use constant memory.
+ */
+
+#ifndef MUSEAIR_TREE_H
+#define MUSEAIR_TREE_H
+
+#include "museair.h"
+
+#ifndef MUSEAIR_TREE_NO_THREADS
+    #include <pthread.h>
+    #include <stdlib.h>
+    #include <unistd.h>
+#endif
+
+#define MUSEAIR_TREE_CHUNK ((size_t)1 << 20)
+#define MUSEAIR_TREE_FANOUT 64
+#define MUSEAIR_TREE_LEVELS 8  // leaves plus interior levels, enough for 2^62 bytes.
+#define MUSEAIR_TREE_TWEAK UINT64_C(0x656572546573754d)
+
+typedef struct {
+    museair_stream_t leaf;
+    size_t leaf_len;
+    uint64_t seed;
+    size_t count[MUSEAIR_TREE_LEVELS];  // nodes pushed into each level so far.
+    uint8_t nodes[MUSEAIR_TREE_LEVELS][MUSEAIR_TREE_FANOUT * 16];
+} museair_tree_t;
+
+/*----------------------------------------------------------------------------*/
+
+static inline void _museair_tree_push(museair_tree_t* t, size_t level, uint64_t lo, uint64_t hi) {
+    for (;;) {
+        size_t n = t->count[level]++ % MUSEAIR_TREE_FANOUT;
+        _museair_write_u64(&t->nodes[level][n * 16 + 0], lo);
+        _museair_write_u64(&t->nodes[level][n * 16 + 8], hi);
+        if (n + 1 < MUSEAIR_TREE_FANOUT) {
+            return;
+        }
+        lo = museair_hash_128(&t->nodes[level][0], MUSEAIR_TREE_FANOUT * 16,
+                              t->seed ^ MUSEAIR_TREE_TWEAK ^ (level + 1), &hi);
+        level++;
+    }
+}
+
+// Hashes the partial group of every level into the next one, bottom-up, until a single node remains.
+static inline uint64_t _museair_tree_finish(museair_tree_t* t, uint64_t* upper_half) {
+    for (size_t level = 0;; level++) {
+        if (level > 0 && t->count[level] == 1) {
+            *upper_half = _museair_read_u64(&t->nodes[level][8]);
+            return _museair_read_u64(&t->nodes[level][0]);
+        }
+        size_t n = t->count[level] % MUSEAIR_TREE_FANOUT;
+        if (n > 0) {
+            uint64_t hi, lo = museair_hash_128(&t->nodes[level][0], n * 16,
+                                               t->seed ^ MUSEAIR_TREE_TWEAK ^ (level + 1), &hi);
+            _museair_tree_push(t, level + 1, lo, hi);
+        }
+    }
+}
+
+static inline void _museair_tree_reset(museair_tree_t* t, const uint64_t seed) {
+    museair_stream_init(&t->leaf, seed);
+    t->leaf_len = 0;
+    t->seed = seed;
+    memset(&t->count[0], 0, sizeof(t->count));
+}
+
+/*----------------------------------------------------------------------------*/
+
+static inline void museair_tree_init(museair_tree_t* t, const uint64_t seed) {
+    _museair_tree_reset(t, seed);
+}
+
+static inline void museair_tree_update(museair_tree_t* t, const void* in, size_t len) {
+    const uint8_t* p = (const uint8_t*)in;
+    while (len > 0) {
+        size_t n = MUSEAIR_TREE_CHUNK - t->leaf_len;
+        n = len < n ? len : n;
+        museair_stream_update(&t->leaf, p, n);
+        t->leaf_len += n;
+        p += n;
+        len -= n;
+        if (t->leaf_len == MUSEAIR_TREE_CHUNK) {
+            uint64_t hi, lo = museair_stream_digest_128(&t->leaf, &hi);
+            _museair_tree_push(t, 0, lo, hi);
+            museair_stream_init(&t->leaf, t->seed);
+            t->leaf_len = 0;
+        }
+    }
+}
+
+// Does not modify `t`, more data may be appended afterwards.
+static inline uint64_t museair_tree_digest_128(const museair_tree_t* t, uint64_t* upper_half) {
+    museair_tree_t f;
+    memcpy(&f, t, sizeof(f));
+    if (f.leaf_len > 0 || f.count[0] == 0) {
+        uint64_t hi, lo = museair_stream_digest_128(&f.leaf, &hi);
+        _museair_tree_push(&f, 0, lo, hi);
+    }
+    return _museair_tree_finish(&f, upper_half);
+}
+
+static inline uint64_t museair_tree_hash_128(const void* in,
+                                             const size_t len,
+                                             const uint64_t seed,
+                                             uint64_t* upper_half) {
+    museair_tree_t t;
+    museair_tree_init(&t, seed);
+    museair_tree_update(&t, in, len);
+    return museair_tree_digest_128(&t, upper_half);
+}
+
+/*----------------------------------------------------------------------------*/
+
+#ifndef MUSEAIR_TREE_NO_THREADS
+
+typedef struct {
+    const uint8_t* in;
+    size_t len;
+    uint64_t seed;
+    size_t leaves;
+    size_t next;  // next leaf to claim, shared by all workers.
+    uint64_t* digests;
+} _museair_tree_job_t;
+
+static void* _museair_tree_worker(void* arg) {
+    _museair_tree_job_t* job = (_museair_tree_job_t*)arg;
+    for (;;) {
+        size_t n = __atomic_fetch_add(&job->next, 1, __ATOMIC_RELAXED);
+        if (n >= job->leaves) {
+            return NULL;
+        }
+        size_t off = n * MUSEAIR_TREE_CHUNK;
+        size_t len = job->len - off < MUSEAIR_TREE_CHUNK ? job->len - off : MUSEAIR_TREE_CHUNK;
+        job->digests[2 * n + 0] = museair_hash_128(job->in + off, len, job->seed, &job->digests[2 * n + 1]);
+    }
+}
+
+// Same digest as `museair_tree_hash_128`, with leaves hashed by `threads` threads (0 for one per online CPU).
+// Falls back to the single-threaded reference if threads cannot be created.
+static inline uint64_t museair_tree_hash_128_parallel(const void* in,
+                                                      const size_t len,
+                                                      const uint64_t seed,
+                                                      int threads,
+                                                      uint64_t* upper_half) {
+    _museair_tree_job_t job = {(const uint8_t*)in, len, seed, 0, 0, NULL};
+    job.leaves = len == 0 ? 1 : (len - 1) / MUSEAIR_TREE_CHUNK + 1;
+    if (threads <= 0) {
+        long n = sysconf(_SC_NPROCESSORS_ONLN);
+        threads = n > 0 ? (int)n : 1;
+    }
+    if ((size_t)threads > job.leaves) {
+        threads = (int)job.leaves;
+    }
+
+    pthread_t* pool = (pthread_t*)malloc(sizeof(pthread_t) * (size_t)threads);
+    job.digests = (uint64_t*)malloc(sizeof(uint64_t) * 2 * job.leaves);
+    if (threads == 1 || !pool || !job.digests) {
+        free(job.digests);
+        free(pool);
+        return museair_tree_hash_128(in, len, seed, upper_half);
+    }
+
+    int spawned = 0;
+    while (spawned < threads - 1 && pthread_create(&pool[spawned], NULL, _museair_tree_worker, &job) == 0) {
+        spawned++;
+    }
+    _museair_tree_worker(&job);
+    for (int n = 0; n < spawned; n++) {
+        pthread_join(pool[n], NULL);
+    }
+
+    museair_tree_t* t = (museair_tree_t*)malloc(sizeof(museair_tree_t));
+    uint64_t lo;
+    if (t) {
+        _museair_tree_reset(t, seed);
+        for (size_t n = 0; n < job.leaves; n++) {
+            _museair_tree_push(t, 0, job.digests[2 * n + 0], job.digests[2 * n + 1]);
+        }
+        lo = _museair_tree_finish(t, upper_half);
+    } else {
+        lo = museair_tree_hash_128(in, len, seed, upper_half);
+    }
+
+    free(t);
+    free(job.digests);
+    free(pool);
+    return lo;
+}
+
+#endif  // MUSEAIR_TREE_NO_THREADS
+
+#endif  // MUSEAIR_TREE_H
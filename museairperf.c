@@ -0,0 +1,378 @@
+/*
+ * museairperf - generate a C header that recognizes a fixed keyword set with one MuseAir hash and one compare,
+ * in the manner of gperf.
+ *
+ *     cc -O2 -o museairperf museairperf.c
+ *     ./museairperf -n sql_keyword sql_keywords.txt > sql_keyword.h
+ *
+ * Keywords are read one per line. The generator searches for a seed that sends every keyword to its own slot of
+ * a power of two table, no larger than `PERF_SPARSE` times the keyword count, taking the low bits of
+ * `museair_hash`. Larger sets, where such a seed is too rare to find, get a displacement per group of slots: the
+ * high bits of the hash pick a group whose 16-bit displacement is xored into the low bits, and the displacements
+ * are found greedily, largest groups first. The generated `<name>_lookup` returns the keyword's line index, or -1.
+ */
+#define _DEFAULT_SOURCE
+#include <ctype.h>
+#include <errno.h>
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "museair.h"
+
+#define PERF_SPARSE 8                   // the largest table of a plain seed, in slots per keyword.
+#define PERF_SEEDS ((uint64_t)1 << 18)  // seeds tried per plain table size.
+#define PERF_MAX_SLOTS 65536
+
+typedef struct {
+    bool bfast;
+    bool nocase;
+    const char* name;
+    const char* source;
+} perf_opts_t;
+
+typedef struct {
+    char** words;
+    size_t* lens;
+    size_t count;
+    uint64_t* hashes;
+    uint64_t seed;
+    uint32_t slot_bits;
+    uint32_t group_bits;  // 0 for a plain seed.
+    int32_t* slots;       // keyword index of each slot, -1 if free.
+    uint16_t* displacements;
+} perf_table_t;
+
+static const char* argv0 = "museairperf";
+
+/*----------------------------------------------------------------------------*/
+
+static uint64_t perf_hash(const perf_opts_t* o, const void* in, size_t len, uint64_t seed) {
+    if (o->nocase) {
+        return o->bfast ? museair_bfast_hash_nocase(in, len, seed) : museair_hash_nocase(in, len, seed);
+    }
+    return o->bfast ? museair_bfast_hash(in, len, seed) : museair_hash(in, len, seed);
+}
+
+static bool perf_same(const perf_opts_t* o, const char* a, size_t a_len, const char* b, size_t b_len) {
+    if (a_len != b_len) {
+        return false;
+    }
+    for (size_t i = 0; i < a_len; i++) {
+        if (o->nocase ? tolower((unsigned char)a[i]) != tolower((unsigned char)b[i]) : a[i] != b[i]) {
+            return false;
+        }
+    }
+    return true;
+}
+
+static int perf_read(const perf_opts_t* o, FILE* in, perf_table_t* t) {
+    size_t capacity = 0;
+    char* line = NULL;
+    size_t line_capacity = 0;
+    ssize_t len;
+    while ((len = getline(&line, &line_capacity, in)) >= 0) {
+        while (len > 0 && (line[len - 1] == '\n' || line[len - 1] == '\r')) {
+            len--;
+        }
+        if (len == 0) {
+            continue;
+        }
+        for (size_t n = 0; n < t->count; n++) {
+            if (perf_same(o, t->words[n], t->lens[n], line, (size_t)len)) {
+                fprintf(stderr, "%s: %s: duplicate keyword '%.*s'\n", argv0, o->source, (int)len, line);
+                free(line);
+                return -1;
+            }
+        }
+        if (t->count == capacity) {
+            capacity = capacity ? capacity * 2 : 64;
+            t->words = (char**)realloc(t->words, capacity * sizeof(char*));
+            t->lens = (size_t*)realloc(t->lens, capacity * sizeof(size_t));
+        }
+        t->words[t->count] = (char*)malloc((size_t)len + 1);
+        memcpy(t->words[t->count], line, (size_t)len + 1);
+        t->lens[t->count++] = (size_t)len;
+    }
+    free(line);
+    if (ferror(in)) {
+        fprintf(stderr, "%s: %s: %s\n", argv0, o->source, strerror(errno));
+        return -1;
+    }
+    return 0;
+}
+
+/*----------------------------------------------------------------------------*/
+
+// Looks for a seed that puts every keyword on its own slot of `1 << bits`.
+static bool perf_plain(const perf_opts_t* o, perf_table_t* t, uint32_t bits) {
+    const uint64_t mask = ((uint64_t)1 << bits) - 1;
+    for (uint64_t seed = 0; seed < PERF_SEEDS; seed++) {
+        memset(t->slots, 0xff, sizeof(int32_t) << bits);
+        size_t n = 0;
+        for (; n < t->count; n++) {
+            const uint64_t slot = perf_hash(o, t->words[n], t->lens[n], seed) & mask;
+            if (t->slots[slot] >= 0) {
+                break;
+            }
+            t->slots[slot] = (int32_t)n;
+        }
+        if (n == t->count) {
+            t->seed = seed;
+            t->slot_bits = bits;
+            t->group_bits = 0;
+            return true;
+        }
+    }
+    return false;
+}
+
+// Finds displacements for `seed`, into slots of `1 << bits` and groups of `1 << group_bits`.
+static bool perf_displace(const perf_opts_t* o, perf_table_t* t, uint64_t seed, uint32_t bits, uint32_t group_bits) {
+    const size_t groups = (size_t)1 << group_bits, slots = (size_t)1 << bits;
+    size_t* start = (size_t*)calloc(groups + 2, sizeof(size_t));
+    size_t* members = (size_t*)malloc(t->count * sizeof(size_t));
+    size_t* order = (size_t*)malloc(groups * sizeof(size_t));
+    bool ok = true;
+
+    // Sorts keywords by group, then groups by size, largest first.
+    size_t largest = 0, ordered = 0;
+    for (size_t n = 0; n < t->count; n++) {
+        t->hashes[n] = perf_hash(o, t->words[n], t->lens[n], seed);
+        start[(t->hashes[n] >> (64 - group_bits)) + 2]++;
+    }
+    for (size_t g = 0; g < groups; g++) {
+        largest = start[g + 2] > largest ? start[g + 2] : largest;
+        start[g + 2] += start[g + 1];
+    }
+    for (size_t n = 0; n < t->count; n++) {
+        members[start[(t->hashes[n] >> (64 - group_bits)) + 1]++] = n;
+    }
+    for (size_t size = largest; size > 0; size--) {
+        for (size_t g = 0; g < groups; g++) {
+            if (start[g + 1] - start[g] == size) {
+                order[ordered++] = g;
+            }
+        }
+    }
+    memset(t->slots, 0xff, sizeof(int32_t) * slots);
+    memset(t->displacements, 0, sizeof(uint16_t) * groups);
+
+    for (size_t g = 0; ok && g < ordered; g++) {
+        const size_t m = start[order[g] + 1] - start[order[g]];
+        const size_t* group = members + start[order[g]];
+        // Keywords of a group agreeing on the low bits would agree under every displacement.
+        for (size_t i = 0; ok && i < m; i++) {
+            for (size_t j = 0; j < i; j++) {
+                ok &= ((t->hashes[group[i]] ^ t->hashes[group[j]]) & (slots - 1)) != 0;
+            }
+        }
+        size_t d = 0;
+        for (; ok && d < slots; d++) {
+            size_t i = 0;
+            while (i < m && t->slots[(t->hashes[group[i]] ^ d) & (slots - 1)] < 0) {
+                i++;
+            }
+            if (i == m) {
+                break;
+            }
+        }
+        ok &= d < slots;
+        for (size_t i = 0; ok && i < m; i++) {
+            t->slots[(t->hashes[group[i]] ^ d) & (slots - 1)] = (int32_t)group[i];
+        }
+        t->displacements[order[g]] = (uint16_t)d;
+    }
+    if (ok) {
+        t->seed = seed;
+        t->slot_bits = bits;
+        t->group_bits = group_bits;
+    }
+    free(order);
+    free(members);
+    free(start);
+    return ok;
+}
+
+static bool perf_search(const perf_opts_t* o, perf_table_t* t) {
+    uint32_t bits = 0;
+    while (((size_t)1 << bits) < t->count) {
+        bits++;
+    }
+    t->slots = (int32_t*)malloc(sizeof(int32_t) * PERF_MAX_SLOTS);
+    t->displacements = (uint16_t*)malloc(sizeof(uint16_t) * PERF_MAX_SLOTS);
+    t->hashes = (uint64_t*)malloc(sizeof(uint64_t) * (t->count + 1));
+    const size_t limit = PERF_SPARSE * (t->count ? t->count : 1);
+    for (uint32_t b = bits; ((size_t)1 << b) <= limit && ((size_t)1 << b) <= PERF_MAX_SLOTS; b++) {
+        if (perf_plain(o, t, b)) {
+            return true;
+        }
+    }
+    // Groups of two keywords on average, in a table at most half full.
+    for (uint32_t b = bits + 1; ((size_t)1 << b) <= PERF_MAX_SLOTS; b++) {
+        for (uint64_t seed = 0; seed < 64; seed++) {
+            if (perf_displace(o, t, seed, b, bits > 1 ? bits - 1 : 1)) {
+                return true;
+            }
+        }
+    }
+    return false;
+}
+
+/*----------------------------------------------------------------------------*/
+
+static void perf_string(FILE* out, const char* s, size_t len) {
+    fputc('"', out);
+    for (size_t i = 0; i < len; i++) {
+        const unsigned char c = (unsigned char)s[i];
+        if (c == '"' || c == '\\') {
+            fprintf(out, "\\%c", c);
+        } else if (c < 0x20 || c >= 0x7f || c == '?') {
+            fprintf(out, "\\%03o", c);  // also keeps "??" trigraphs out.
+        } else {
+            fputc(c, out);
+        }
+    }
+    fputc('"', out);
+}
+
+static const char* perf_function(const perf_opts_t* o) {
+    if (o->nocase) {
+        return o->bfast ? "museair_bfast_hash_nocase" : "museair_hash_nocase";
+    }
+    return o->bfast ? "museair_bfast_hash" : "museair_hash";
+}
+
+static void perf_emit(const perf_opts_t* o, const perf_table_t* t, FILE* out) {
+    const char* n = o->name;
+    const size_t slots = (size_t)1 << t->slot_bits, groups = t->group_bits ? (size_t)1 << t->group_bits : 0;
+    char upper[256];
+    size_t u = 0;
+    for (; n[u] && u + 1 < sizeof(upper); u++) {
+        upper[u] = (char)toupper((unsigned char)n[u]);
+    }
+    upper[u] = '\0';
+
+    fprintf(out, "/*\n * Generated by museairperf from %s, do not edit.\n *\n", o->source);
+    fprintf(out, " * %zu keywords in %zu slots, %s with seed %" PRIu64 ".\n */\n\n", t->count, slots,
+            perf_function(o), t->seed);
+    fprintf(out, "#ifndef %s_H\n#define %s_H\n\n#include <string.h>\n\n#include \"museair.h\"\n\n", upper, upper);
+    fprintf(out, "#define %s_COUNT %zu\n\n", upper, t->count);
+
+    // Arrays get a placeholder entry when there are no keywords, as C has no empty initializers.
+    fprintf(out, "static const char* const %s_words[%zu] = {\n", n, t->count ? t->count : 1);
+    for (size_t i = 0; i < t->count; i++) {
+        fprintf(out, "    ");
+        perf_string(out, t->words[i], t->lens[i]);
+        fprintf(out, ",\n");
+    }
+    fprintf(out, "%s};\n\nstatic const size_t %s_lens[%zu] = {", t->count ? "" : "    \"\",\n", n,
+            t->count ? t->count : 1);
+    for (size_t i = 0; i < t->count; i++) {
+        fprintf(out, "%s%zu,", i % 16 ? " " : "\n    ", t->lens[i]);
+    }
+    fprintf(out, "%s\n};\n\n", t->count ? "" : "0");
+
+    fprintf(out, "// Index of the keyword `in[len]` in `%s_words`, or -1 if it is not one.\n", n);
+    fprintf(out, "static inline int %s_lookup(const void* in, const size_t len) {\n", n);
+    fprintf(out, "    static const %s slots[%zu] = {", t->count < 128 ? "int8_t" : "int16_t", slots);
+    for (size_t i = 0; i < slots; i++) {
+        fprintf(out, "%s%d,", i % 16 ? " " : "\n        ", (int)t->slots[i]);
+    }
+    fprintf(out, "\n    };\n");
+    if (groups) {
+        fprintf(out, "    static const uint16_t displacements[%zu] = {", groups);
+        for (size_t i = 0; i < groups; i++) {
+            fprintf(out, "%s%u,", i % 16 ? " " : "\n        ", (unsigned)t->displacements[i]);
+        }
+        fprintf(out, "\n    };\n");
+    }
+    fprintf(out, "    const uint64_t h = %s(in, len, UINT64_C(%" PRIu64 "));\n", perf_function(o), t->seed);
+    if (groups) {
+        fprintf(out, "    const int i = slots[(h ^ displacements[h >> %u]) & %zu];\n", 64 - t->group_bits, slots - 1);
+    } else {
+        fprintf(out, "    const int i = slots[h & %zu];\n", slots - 1);
+    }
+    fprintf(out, "    if (i < 0 || %s_lens[i] != len) {\n        return -1;\n    }\n", n);
+    if (o->nocase) {
+        fprintf(out, "    for (size_t k = 0; k < len; k++) {\n");
+        fprintf(out, "        uint8_t a = (uint8_t)%s_words[i][k], b = ((const uint8_t*)in)[k];\n", n);
+        fprintf(out, "        a = (uint8_t)(a - 'A') < 26 ? a | 0x20 : a;\n");
+        fprintf(out, "        b = (uint8_t)(b - 'A') < 26 ? b | 0x20 : b;\n");
+        fprintf(out, "        if (a != b) {\n            return -1;\n        }\n    }\n    return i;\n");
+    } else {
+        fprintf(out, "    return memcmp(%s_words[i], in, len) == 0 ? i : -1;\n", n);
+    }
+    fprintf(out, "}\n\n#endif  // %s_H\n", upper);
+}
+
+/*----------------------------------------------------------------------------*/
+
+static void usage(void) {
+    fprintf(stderr,
+            "usage: %s [-f] [-i] [-n NAME] [KEYWORDS]\n"
+            "\n"
+            "  -f        use the BFast variant\n"
+            "  -i        ASCII case-insensitive keywords\n"
+            "  -n NAME   prefix of the generated names, a C identifier (default keyword)\n"
+            "\n"
+            "Reads one keyword per line from KEYWORDS, or standard input when it is - or missing,\n"
+            "and writes the header to standard output.\n",
+            argv0);
+    exit(2);
+}
+
+int main(int argc, char** argv) {
+    perf_opts_t o = {false, false, "keyword", "-"};
+    int c;
+    while ((c = getopt(argc, argv, "fin:")) != -1) {
+        switch (c) {
+            case 'f':
+                o.bfast = true;
+                break;
+            case 'i':
+                o.nocase = true;
+                break;
+            case 'n':
+                o.name = optarg;
+                break;
+            default:
+                usage();
+        }
+    }
+    if (argc - optind > 1 || !o.name[0] || isdigit((unsigned char)o.name[0]) ||
+        strspn(o.name, "abcdefghijklmnopqrstuvwxyzABCDEFGHIJKLMNOPQRSTUVWXYZ0123456789_") != strlen(o.name))
+        usage();
+
+    o.source = optind < argc ? argv[optind] : "-";
+    FILE* in = strcmp(o.source, "-") == 0 ? stdin : fopen(o.source, "r");
+    if (!in) {
+        fprintf(stderr, "%s: %s: %s\n", argv0, o.source, strerror(errno));
+        return 1;
+    }
+    perf_table_t t;
+    memset(&t, 0, sizeof(t));
+    int status = perf_read(&o, in, &t);
+    if (in != stdin)
+        fclose(in);
+    if (status == 0 && t.count >= PERF_MAX_SLOTS / 2) {
+        fprintf(stderr, "%s: %s: too many keywords, at most %d\n", argv0, o.source, PERF_MAX_SLOTS / 2 - 1);
+        status = -1;
+    }
+    if (status == 0 && !perf_search(&o, &t)) {
+        fprintf(stderr, "%s: %s: no perfect hash found\n", argv0, o.source);
+        status = -1;
+    }
+    if (status == 0)
+        perf_emit(&o, &t, stdout);
+    for (size_t n = 0; n < t.count; n++)
+        free(t.words[n]);
+    free(t.words);
+    free(t.lens);
+    free(t.hashes);
+    free(t.slots);
+    free(t.displacements);
+    return status == 0 ? 0 : 1;
+}
@@ -0,0 +1,394 @@
+/*
+ * museairsum - print or check MuseAir digests of files, in the manner of sha256sum.
+ *
+ *     cc -O2 -pthread -o museairsum museairsum.c
+ *
+ * Regular files are mmap'ed in windows of `SUM_WINDOW` bytes, each window is populated up front, advised as
+ * sequential and unmapped once hashed, so RSS stays bounded whatever the file size. Files larger than one
+ * window go through `museair_stream_t`. Pipes, terminals and files that cannot be mapped are read() instead.
+ *
+ * With -t the tree digest of "museair_tree.h" is printed, regular files are then mapped whole and their leaves
+ * hashed on all CPUs.
+ */
+#define _DEFAULT_SOURCE
+#include <errno.h>
+#include <fcntl.h>
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "museair.h"
+#include "museair_tree.h"
+
+#define SUM_WINDOW ((size_t)64 << 20)
+#define SUM_READ_BUFFER ((size_t)1 << 20)
+
+#ifndef MAP_POPULATE
+    #define MAP_POPULATE 0
+#endif
+
+typedef struct {
+    int bits;  // 64 or 128.
+    bool bfast;
+    bool tree;
+    uint64_t seed;
+} sum_opts_t;
+
+typedef struct {
+    uint64_t lo, hi;
+} sum_digest_t;
+
+static const char* argv0 = "museairsum";
+
+/*----------------------------------------------------------------------------*/
+
+static sum_digest_t sum_oneshot(const sum_opts_t* o, const void* in, size_t len) {
+    sum_digest_t d = {0, 0};
+    if (o->bits == 64) {
+        d.lo = o->bfast ? museair_bfast_hash(in, len, o->seed) : museair_hash(in, len, o->seed);
+    } else {
+        d.lo = o->bfast ? museair_bfast_hash_128(in, len, o->seed, &d.hi) : museair_hash_128(in, len, o->seed, &d.hi);
+    }
+    return d;
+}
+
+static int sum_tree_mapped(const sum_opts_t* o, int fd, size_t size, sum_digest_t* d) {
+    // Not populated up front, the workers fault their own leaves in.
+    void* p = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (p == MAP_FAILED) {
+        return 1;
+    }
+    d->lo = museair_tree_hash_128_parallel(p, size, o->seed, 0, &d->hi);
+    munmap(p, size);
+    return 0;
+}
+
+static int sum_tree_read(const sum_opts_t* o, int fd, uint8_t* buf, sum_digest_t* d) {
+    static museair_tree_t t;
+    museair_tree_init(&t, o->seed);
+    for (;;) {
+        ssize_t n = read(fd, buf, SUM_READ_BUFFER);
+        if (n == 0) {
+            break;
+        }
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return -1;
+        }
+        museair_tree_update(&t, buf, (size_t)n);
+    }
+    d->lo = museair_tree_digest_128(&t, &d->hi);
+    return 0;
+}
+
+static void sum_update(const sum_opts_t* o, museair_stream_t* s, const void* in, size_t len) {
+    if (o->bfast) {
+        museair_bfast_stream_update(s, in, len);
+    } else {
+        museair_stream_update(s, in, len);
+    }
+}
+
+static sum_digest_t sum_digest(const sum_opts_t* o, const museair_stream_t* s) {
+    sum_digest_t d = {0, 0};
+    if (o->bits == 64) {
+        d.lo = o->bfast ? museair_bfast_stream_digest(s) : museair_stream_digest(s);
+    } else {
+        d.lo = o->bfast ? museair_bfast_stream_digest_128(s, &d.hi) : museair_stream_digest_128(s, &d.hi);
+    }
+    return d;
+}
+
+static void* sum_map(int fd, size_t len, off_t off) {
+    void* p = mmap(NULL, len, PROT_READ, MAP_PRIVATE | MAP_POPULATE, fd, off);
+    if (p == MAP_FAILED) {
+        return NULL;
+    }
+#ifdef MADV_SEQUENTIAL
+    madvise(p, len, MADV_SEQUENTIAL);
+#endif
+    return p;
+}
+
+// Returns 1 if mmap is not applicable and the caller should fall back to read(), -1 on error.
+static int sum_mapped(const sum_opts_t* o, int fd, size_t size, sum_digest_t* d) {
+    if (o->tree) {
+        return sum_tree_mapped(o, fd, size, d);
+    }
+    if (size <= SUM_WINDOW) {
+        void* p = sum_map(fd, size, 0);
+        if (!p) {
+            return 1;
+        }
+        *d = sum_oneshot(o, p, size);
+        munmap(p, size);
+        return 0;
+    }
+
+    museair_stream_t s;
+    museair_stream_init(&s, o->seed);
+    for (size_t off = 0; off < size; off += SUM_WINDOW) {
+        size_t len = size - off < SUM_WINDOW ? size - off : SUM_WINDOW;
+        void* p = sum_map(fd, len, (off_t)off);
+        if (!p) {
+            // Nothing has been read from `fd` yet only if we failed on the first window.
+            return off == 0 ? 1 : -1;
+        }
+        sum_update(o, &s, p, len);
+        munmap(p, len);
+    }
+    *d = sum_digest(o, &s);
+    return 0;
+}
+
+static int sum_read(const sum_opts_t* o, int fd, sum_digest_t* d) {
+    static uint8_t* buf = NULL;
+    if (!buf && !(buf = (uint8_t*)malloc(SUM_READ_BUFFER))) {
+        return -1;
+    }
+    if (o->tree) {
+        return sum_tree_read(o, fd, buf, d);
+    }
+
+    museair_stream_t s;
+    museair_stream_init(&s, o->seed);
+    for (;;) {
+        ssize_t n = read(fd, buf, SUM_READ_BUFFER);
+        if (n == 0) {
+            break;
+        }
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return -1;
+        }
+        sum_update(o, &s, buf, (size_t)n);
+    }
+    *d = sum_digest(o, &s);
+    return 0;
+}
+
+static int sum_fd(const sum_opts_t* o, int fd, sum_digest_t* d) {
+    struct stat st;
+    if (fstat(fd, &st) == 0 && S_ISREG(st.st_mode) && st.st_size > 0) {
+        int r = sum_mapped(o, fd, (size_t)st.st_size, d);
+        if (r <= 0) {
+            return r;
+        }
+    }
+    return sum_read(o, fd, d);
+}
+
+// Hashes `path`, or stdin for "-". Reports the error and returns -1 on failure.
+static int sum_path(const sum_opts_t* o, const char* path, sum_digest_t* d) {
+    int fd = strcmp(path, "-") ? open(path, O_RDONLY) : STDIN_FILENO;
+    if (fd < 0) {
+        fprintf(stderr, "%s: %s: %s\n", argv0, path, strerror(errno));
+        return -1;
+    }
+    int r = sum_fd(o, fd, d);
+    if (r < 0) {
+        fprintf(stderr, "%s: %s: %s\n", argv0, path, strerror(errno));
+    }
+    if (fd != STDIN_FILENO) {
+        close(fd);
+    }
+    return r;
+}
+
+/*----------------------------------------------------------------------------*/
+
+static void sum_format(const sum_opts_t* o, sum_digest_t d, char* hex) {
+    if (o->bits == 64) {
+        sprintf(hex, "%016" PRIx64, d.lo);
+    } else {
+        sprintf(hex, "%016" PRIx64 "%016" PRIx64, d.hi, d.lo);
+    }
+}
+
+// Whether `path` needs escaping, its lines then start with a backslash, as with sha256sum.
+static bool sum_escapes(const char* path) {
+    return strpbrk(path, "\\\n\r") != NULL;
+}
+
+// Prints `path` with `\\`, `\n` and `\r` escaped, so that each line of a manifest holds one file.
+static void sum_print_path(const char* path) {
+    for (; *path; path++) {
+        if (*path == '\\' || *path == '\n' || *path == '\r') {
+            putchar('\\');
+            putchar(*path == '\\' ? '\\' : *path == '\n' ? 'n' : 'r');
+        } else {
+            putchar(*path);
+        }
+    }
+}
+
+// Undoes `sum_print_path` in place. Returns false on any other escape, or a trailing backslash.
+static bool sum_unescape(char* path) {
+    char* out = path;
+    for (; *path; path++) {
+        if (*path != '\\') {
+            *out++ = *path;
+            continue;
+        }
+        path++;
+        if (*path != '\\' && *path != 'n' && *path != 'r') {
+            return false;
+        }
+        *out++ = *path == '\\' ? '\\' : *path == 'n' ? '\n' : '\r';
+    }
+    *out = '\0';
+    return true;
+}
+
+// Prints the `-c` result of `path`, escaped as in the manifest.
+static void sum_report(const char* path, const char* result) {
+    if (sum_escapes(path)) {
+        putchar('\\');
+    }
+    sum_print_path(path);
+    printf(": %s\n", result);
+}
+
+// Verifies every "<digest>  <path>" line of `manifest`, the digest length selects 64 or 128 bits. A line starting
+// with a backslash has its path escaped by `sum_print_path`.
+static int sum_check(const sum_opts_t* opts, const char* manifest, int quiet) {
+    FILE* f = strcmp(manifest, "-") ? fopen(manifest, "r") : stdin;
+    if (!f) {
+        fprintf(stderr, "%s: %s: %s\n", argv0, manifest, strerror(errno));
+        return 1;
+    }
+
+    char line[8192], hex[33];
+    size_t lineno = 0, bad_lines = 0, mismatched = 0, unreadable = 0;
+    while (fgets(line, sizeof(line), f)) {
+        lineno++;
+        line[strcspn(line, "\r\n")] = '\0';
+        const bool escaped = line[0] == '\\';
+        char* digest = &line[escaped];
+        size_t n = strspn(digest, "0123456789abcdefABCDEF");
+        bool bad_len = opts->tree ? n != 32 : n != 16 && n != 32;
+        if (bad_len || digest[n] != ' ' || (digest[n + 1] != ' ' && digest[n + 1] != '*') || !digest[n + 2] ||
+            (escaped && !sum_unescape(&digest[n + 2]))) {
+            bad_lines++;
+            continue;
+        }
+        const char* path = &digest[n + 2];
+        digest[n] = '\0';
+
+        sum_opts_t o = *opts;
+        o.bits = n == 16 ? 64 : 128;
+        sum_digest_t d;
+        if (sum_path(&o, path, &d) < 0) {
+            sum_report(path, "FAILED open or read");
+            unreadable++;
+            continue;
+        }
+        sum_format(&o, d, hex);
+        if (strcasecmp(hex, digest) != 0) {
+            sum_report(path, "FAILED");
+            mismatched++;
+        } else if (!quiet) {
+            sum_report(path, "OK");
+        }
+    }
+    if (f != stdin) {
+        fclose(f);
+    }
+
+    if (bad_lines)
+        fprintf(stderr, "%s: WARNING: %zu line%s improperly formatted\n", argv0, bad_lines,
+                bad_lines > 1 ? "s are" : " is");
+    if (unreadable)
+        fprintf(stderr, "%s: WARNING: %zu listed file%s could not be read\n", argv0, unreadable,
+                unreadable > 1 ? "s" : "");
+    if (mismatched)
+        fprintf(stderr, "%s: WARNING: %zu computed checksum%s did NOT match\n", argv0, mismatched,
+                mismatched > 1 ? "s" : "");
+    return lineno == bad_lines || unreadable || mismatched;
+}
+
+static void usage(void) {
+    fprintf(stderr,
+            "usage: %s [-f | -t] [-l 64|128] [-s SEED] [FILE]...\n"
+            "       %s -c [-q] [-f | -t] [-s SEED] [MANIFEST]...\n"
+            "\n"
+            "  -c        read digests from MANIFEST and check them\n"
+            "  -f        use the BFast variant\n"
+            "  -l BITS   digest length, 64 or 128 (default)\n"
+            "  -q        with -c, don't print OK for each verified file\n"
+            "  -s SEED   seed, decimal or 0x-prefixed hex (default 0)\n"
+            "  -t        print the 128-bit tree digest, hashed on all CPUs\n"
+            "\n"
+            "With no FILE, or when FILE is -, read standard input.\n",
+            argv0, argv0);
+    exit(2);
+}
+
+int main(int argc, char** argv) {
+    sum_opts_t o = {128, false, false, 0};
+    int check = 0, quiet = 0, c;
+    char* end;
+    while ((c = getopt(argc, argv, "cfl:qs:t")) != -1) {
+        switch (c) {
+            case 'c':
+                check = 1;
+                break;
+            case 'f':
+                o.bfast = true;
+                break;
+            case 'l':
+                o.bits = atoi(optarg);
+                if (o.bits != 64 && o.bits != 128)
+                    usage();
+                break;
+            case 'q':
+                quiet = 1;
+                break;
+            case 's':
+                errno = 0;
+                o.seed = strtoull(optarg, &end, 0);
+                if (errno || *end || end == optarg)
+                    usage();
+                break;
+            case 't':
+                o.tree = true;
+                break;
+            default:
+                usage();
+        }
+    }
+
+    if (o.tree && (o.bfast || o.bits != 128))
+        usage();
+
+    char* stdin_only[] = {(char*)"-"};
+    char** paths = optind < argc ? &argv[optind] : stdin_only;
+    int count = optind < argc ? argc - optind : 1;
+
+    int status = 0;
+    for (int n = 0; n < count; n++) {
+        if (check) {
+            status |= sum_check(&o, paths[n], quiet);
+            continue;
+        }
+        sum_digest_t d;
+        char hex[33];
+        if (sum_path(&o, paths[n], &d) < 0) {
+            status = 1;
+            continue;
+        }
+        sum_format(&o, d, hex);
+        printf("%s%s  ", sum_escapes(paths[n]) ? "\\" : "", hex);
+        sum_print_path(paths[n]);
+        putchar('\n');
+    }
+    return status;
+}
@@ -23,6 +23,8 @@
  * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
  * OTHER DEALINGS IN THE SOFTWARE.
  */
+#include <ctype.h>
+#include <math.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <stdint.h>
@@ -66,6 +68,15 @@ uint32_t ComputedVerifyImpl(const uint32_t hashbits,
 }
 
 #include "museair.h"
+#include "museair_bloom.h"
+#include "museair_cms.h"
+#include "museair_cuckoo.h"
+#include "museair_fuse.h"
+#include "museair_hll.h"
+#define MUSEAIR_MPHF_PARTITION 1000  // small partitions, to test several of them in a few thousand keys.
+#include "museair_mphf.h"
+#include "museair_route.h"
+#include "museair_tree.h"
 
 void hash(const void* in, const size_t len, const uint64_t seed, void* out) {
     uint64_t i = museair_hash(in, len, seed);
@@ -88,7 +99,508 @@ void bfast_hash_128(const void* in, const size_t len, const uint64_t seed, void*
     memcpy(&((uint8_t*)out)[8], &j, 8);
 }
 
+// Feeds `len` bytes in pieces of `step` bytes, returns whether all four digests match the one-shot functions.
+int StreamMatches(const uint8_t* in, const size_t len, const uint64_t seed, const size_t step) {
+    museair_stream_t s, t;
+    museair_stream_init(&s, seed);
+    museair_stream_init(&t, seed);
+    for (size_t off = 0; off < len; off += step) {
+        size_t n = len - off < step ? len - off : step;
+        museair_stream_update(&s, in + off, n);
+        museair_bfast_stream_update(&t, in + off, n);
+    }
+
+    uint64_t hi, hi_expected;
+    int ok = 1;
+    ok &= museair_stream_digest(&s) == museair_hash(in, len, seed);
+    ok &= museair_bfast_stream_digest(&t) == museair_bfast_hash(in, len, seed);
+    ok &= museair_stream_digest_128(&s, &hi) == museair_hash_128(in, len, seed, &hi_expected);
+    ok &= hi == hi_expected;
+    ok &= museair_bfast_stream_digest_128(&t, &hi) == museair_bfast_hash_128(in, len, seed, &hi_expected);
+    ok &= hi == hi_expected;
+    return ok;
+}
+
+// Hashes `n` keys of assorted lengths from `in` with `_museair_hash_batch`, compares them to one-by-one hashing.
+int BatchMatches(const uint8_t* in, const size_t n, const uint64_t seed) {
+    const void** keys = (const void**)malloc(n * sizeof(void*));
+    size_t* lens = (size_t*)malloc(n * sizeof(size_t));
+    uint64_t* out = (uint64_t*)malloc(n * 2 * sizeof(uint64_t));
+    for (size_t i = 0; i < n; i++) {
+        keys[i] = in + i;
+        lens[i] = i % 11 == 10 || i % 4 < 2 ? i * 7 % 300 : i % 17;
+    }
+
+    int ok = 1;
+    uint64_t hi;
+    _museair_hash_batch(false, false, keys, lens, n, seed, out);
+    for (size_t i = 0; i < n; i++)
+        ok &= out[i] == museair_hash(keys[i], lens[i], seed);
+    _museair_hash_batch(true, false, keys, lens, n, seed, out);
+    for (size_t i = 0; i < n; i++)
+        ok &= out[i] == museair_bfast_hash(keys[i], lens[i], seed);
+    _museair_hash_batch(false, true, keys, lens, n, seed, out);
+    for (size_t i = 0; i < n; i++)
+        ok &= out[2 * i] == museair_hash_128(keys[i], lens[i], seed, &hi) && out[2 * i + 1] == hi;
+    _museair_hash_batch(true, true, keys, lens, n, seed, out);
+    for (size_t i = 0; i < n; i++)
+        ok &= out[2 * i] == museair_bfast_hash_128(keys[i], lens[i], seed, &hi) && out[2 * i + 1] == hi;
+
+    free(out);
+    free(lens);
+    free(keys);
+    return ok;
+}
+
+// Hashes a fixed-width column of `n` rows of each width, then a variable-length one chained onto it.
+int ColumnMatches(const uint8_t* in, const size_t n, const uint64_t seed) {
+    static const size_t widths[] = {1, 2, 3, 4, 8, 12, 16, 17, 24, 32, 100};
+    uint64_t* first = (uint64_t*)malloc(n * sizeof(uint64_t));
+    uint64_t* out = (uint64_t*)malloc(n * sizeof(uint64_t));
+    int32_t* offsets = (int32_t*)malloc((n + 1) * sizeof(int32_t));
+    int64_t* offsets_large = (int64_t*)malloc((n + 1) * sizeof(int64_t));
+
+    int ok = 1;
+    for (size_t w = 0; w < sizeof(widths) / sizeof(widths[0]); w++) {
+        const size_t width = widths[w], rows = n < 1024 / width ? n : 1024 / width;
+        museair_hash_column(in, width, rows, NULL, seed, first);
+        museair_bfast_hash_column(in, width, rows, first, seed, out);
+        for (size_t r = 0; r < rows; r++) {
+            ok &= first[r] == museair_hash(in + r * width, width, seed);
+            ok &= out[r] == museair_bfast_hash(in + r * width, width, first[r]);
+        }
+    }
+
+    // Rows of the variable-length column are consecutive slices of `in`, some longer than 96 bytes.
+    museair_hash_column(in, 1, n, NULL, seed, first);
+    offsets[0] = 0;
+    offsets_large[0] = 0;
+    for (size_t r = 0; r < n; r++) {
+        offsets[r + 1] = offsets[r] + (int32_t)(r % 5 == 4 ? 100 + r : r % 17);
+        offsets_large[r + 1] = offsets[r + 1];
+    }
+    memcpy(out, first, n * sizeof(uint64_t));
+    museair_hash_column_var(in, offsets, n, out, seed, out);
+    for (size_t r = 0; r < n; r++)
+        ok &= out[r] == museair_hash(in + offsets[r], (size_t)(offsets[r + 1] - offsets[r]), first[r]);
+    museair_bfast_hash_column_var_large(in, offsets_large, n, NULL, seed, out);
+    for (size_t r = 0; r < n; r++)
+        ok &= out[r] == museair_bfast_hash(in + offsets[r], (size_t)(offsets[r + 1] - offsets[r]), seed);
+
+    free(offsets_large);
+    free(offsets);
+    free(out);
+    free(first);
+    return ok;
+}
+
+// `k` seeds, more than `MUSEAIR_MULTISEED_TOWERS` for some calls.
+int MultiseedMatches(const uint8_t* in, const size_t len, const size_t k) {
+    uint64_t seeds[40], out[80], hi;
+    for (size_t t = 0; t < k; t++)
+        seeds[t] = len * 40 + t;
+
+    int ok = 1;
+    museair_hash_multiseed(in, len, seeds, k, out);
+    for (size_t t = 0; t < k; t++)
+        ok &= out[t] == museair_hash(in, len, seeds[t]);
+    museair_bfast_hash_multiseed(in, len, seeds, k, out);
+    for (size_t t = 0; t < k; t++)
+        ok &= out[t] == museair_bfast_hash(in, len, seeds[t]);
+    museair_hash_128_multiseed(in, len, seeds, k, out);
+    for (size_t t = 0; t < k; t++)
+        ok &= out[2 * t] == museair_hash_128(in, len, seeds[t], &hi) && out[2 * t + 1] == hi;
+    museair_bfast_hash_128_multiseed(in, len, seeds, k, out);
+    for (size_t t = 0; t < k; t++)
+        ok &= out[2 * t] == museair_bfast_hash_128(in, len, seeds[t], &hi) && out[2 * t + 1] == hi;
+    return ok;
+}
+
+// Inserts `n` keys of `in`, one by one or batched, checks they are all found, through a saved image too, and that
+// the false positive rate on as many absent keys is near the expected 0.1%.
+int BloomMatches(const uint8_t* in, const size_t n, const int batched) {
+    const void* keys[1024];
+    size_t lens[1024];
+    bool found[1024];
+    for (size_t i = 0; i < n; i++)
+        keys[i] = in + i, lens[i] = i % 40;
+
+    museair_bloom_t f, g;
+    museair_bloom_init(&f, museair_bloom_blocks_for(n, 16), n);
+    memset(&g, 0, sizeof(g));
+    if (batched)
+        museair_bloom_insert_batch(&f, keys, lens, n);
+    else
+        for (size_t i = 0; i < n; i++)
+            museair_bloom_insert(&f, keys[i], lens[i]);
+
+    uint64_t* image = (uint64_t*)malloc(museair_bloom_image_size(&f));
+    museair_bloom_save(&f, image);
+    int ok = !museair_bloom_load(&g, image, museair_bloom_image_size(&f) - 64);
+    ok &= museair_bloom_load(&g, image, museair_bloom_image_size(&f)) && g.nblocks == f.nblocks;
+    museair_bloom_query_batch(&g, keys, lens, n, found);
+    for (size_t i = 0; i < n; i++)
+        ok &= found[i] && museair_bloom_query(&f, keys[i], lens[i]);
+
+    size_t false_positives = 0;
+    for (size_t i = 0; i < n; i++)
+        false_positives += museair_bloom_query(&f, in + i, 40 + i % 40);
+    ok &= false_positives <= 1 + n / 100;
+    free(image);
+    museair_bloom_free(&f);
+    return ok;
+}
+
+// Builds fuse filters of `n` keys of `in` on one and four threads, fills a cuckoo filter with them one by one or
+// batched, then deletes half. Checks every key is found, through saved images too, and the false positive rates on
+// as many absent keys are near the expected 1/256 and 0.01%.
+int FilterMatches(const uint8_t* in, const size_t n) {
+    const void* keys[3000];
+    size_t lens[3000];
+    bool found[3000];
+    for (size_t i = 0; i < n; i++)
+        keys[i] = in + i, lens[i] = 8 + i % 30;
+
+    museair_fuse_t fuse, threaded, loaded;
+    memset(&threaded, 0, sizeof(threaded));
+    memset(&loaded, 0, sizeof(loaded));
+    int ok = museair_fuse_build(&fuse, keys, lens, n, n, 1) && museair_fuse_build(&threaded, keys, lens, n, n, 4);
+    if (!ok) {
+        museair_fuse_free(&fuse), museair_fuse_free(&threaded);
+        return ok;
+    }
+    ok &= threaded.seed == fuse.seed && memcmp(threaded.fingerprints, fuse.fingerprints, fuse.array_length) == 0;
+    uint8_t* image = (uint8_t*)malloc(museair_fuse_image_size(&fuse));
+    museair_fuse_save(&fuse, image);
+    ok &= !museair_fuse_load(&loaded, image, museair_fuse_image_size(&fuse) - 1);
+    ok &= museair_fuse_load(&loaded, image, museair_fuse_image_size(&fuse));
+    museair_fuse_contains_batch(&loaded, keys, lens, n, found);
+    size_t false_positives = 0;
+    for (size_t i = 0; i < n; i++) {
+        ok &= museair_fuse_contains(&fuse, keys[i], lens[i]) && found[i];
+        false_positives += museair_fuse_contains(&fuse, in + i, 40 + i % 40);
+    }
+    ok &= false_positives <= 1 + n / 64;
+    free(image);
+    museair_fuse_free(&fuse), museair_fuse_free(&threaded);
+
+    // Two digests alike but for their fingerprints are distinct keys, not copies: peeling them must fail.
+    if (n >= 2) {
+        _museair_fuse_job_t job;
+        memset(&job, 0, sizeof(job));
+        museair_fuse_t shaped;
+        _museair_fuse_shape(&shaped, n);
+        uint64_t* los = (uint64_t*)malloc(n * sizeof(uint64_t));
+        uint8_t* fps = (uint8_t*)malloc(n);
+        uint8_t* fingerprints = (uint8_t*)calloc(shaped.array_length, 1);
+        for (size_t i = 0; i < n; i++)
+            los[i] = museair_hash_u64(i, n) | 1, fps[i] = (uint8_t)i;
+        los[1] = los[0], fps[1] = fps[0] ^ 1;
+        job.n = n, job.los = los, job.fps = fps;
+        ok &= !_museair_fuse_peel(&shaped, fingerprints, &job);
+        free(fingerprints), free(fps), free(los);
+    }
+
+    museair_cuckoo_t cuckoo, copy;
+    memset(&copy, 0, sizeof(copy));
+    museair_cuckoo_init(&cuckoo, museair_cuckoo_buckets_for(n), n);
+    if (n % 2)
+        ok &= museair_cuckoo_insert_batch(&cuckoo, keys, lens, n) == n;
+    else
+        for (size_t i = 0; i < n; i++)
+            ok &= museair_cuckoo_insert(&cuckoo, keys[i], lens[i]);
+    uint64_t* words = (uint64_t*)malloc(museair_cuckoo_image_size(&cuckoo));
+    museair_cuckoo_save(&cuckoo, words);
+    ok &= !museair_cuckoo_load(&copy, words, museair_cuckoo_image_size(&cuckoo) - 8);
+    const uint64_t victim = words[4];
+    words[4] = _museair_native_u64(UINT64_C(7) << 48 | cuckoo.nbuckets);  // victim past the last bucket.
+    ok &= !museair_cuckoo_load(&copy, words, museair_cuckoo_image_size(&cuckoo));
+    words[4] = _museair_native_u64(cuckoo.nbuckets - 1);  // victim without a fingerprint, unless it is 0.
+    ok &= cuckoo.nbuckets == 1 || !museair_cuckoo_load(&copy, words, museair_cuckoo_image_size(&cuckoo));
+    words[4] = victim;
+    ok &= museair_cuckoo_load(&copy, words, museair_cuckoo_image_size(&cuckoo)) && copy.count == n;
+    museair_cuckoo_contains_batch(&copy, keys, lens, n, found);
+    for (size_t i = 0; i < n; i++)
+        ok &= found[i] && museair_cuckoo_contains(&cuckoo, keys[i], lens[i]);
+    for (size_t i = 0; i < n; i += 2)
+        ok &= museair_cuckoo_delete(&cuckoo, keys[i], lens[i]);
+    ok &= cuckoo.count == n / 2;
+    false_positives = 0;
+    for (size_t i = 0; i < n; i++) {
+        ok &= i % 2 == 0 || museair_cuckoo_contains(&cuckoo, keys[i], lens[i]);
+        false_positives += museair_cuckoo_contains(&cuckoo, in + i, 40 + i % 40);
+    }
+    ok &= false_positives <= 1 + n / 1000;
+    free(words);
+    museair_cuckoo_free(&cuckoo);
+    return ok;
+}
+
+// Builds minimal perfect hash functions of `n` keys of `in` on one and three threads, checks they are the same and
+// map the keys onto `0 .. n - 1`, through a saved image too, and that a duplicate key fails the build.
+int MphfMatches(const uint8_t* in, const size_t n) {
+    const void* keys[5001];
+    size_t lens[5001];
+    bool seen[5000] = {0};
+    for (size_t i = 0; i < n; i++)
+        keys[i] = in + i, lens[i] = 8 + i % 30;
+
+    museair_mphf_t f, threaded, loaded;
+    memset(&threaded, 0, sizeof(threaded));
+    memset(&loaded, 0, sizeof(loaded));
+    int ok = museair_mphf_build(&f, keys, lens, n, n, 1) && museair_mphf_build(&threaded, keys, lens, n, n, 3);
+    if (!ok) {
+        museair_mphf_free(&f), museair_mphf_free(&threaded);
+        return ok;
+    }
+    ok &= museair_mphf_image_size(&f) == museair_mphf_image_size(&threaded) &&
+          memcmp(f.mem, threaded.mem, museair_mphf_image_size(&f)) == 0;
+    uint64_t* image = (uint64_t*)malloc(museair_mphf_image_size(&f));
+    museair_mphf_save(&f, image);
+    ok &= !museair_mphf_load(&loaded, image, museair_mphf_image_size(&f) - 8);
+    const uint64_t first = image[8], counts = image[9];  // of partition 0, after the header.
+    image[9] = _museair_native_u64(UINT64_C(0x7fffffff) << 32 | (_museair_native_u64(counts) & 0xffffffff));
+    ok &= !museair_mphf_load(&loaded, image, museair_mphf_image_size(&f));  // remap entries past the table.
+    image[9] = counts, image[8] = _museair_native_u64(1);
+    ok &= !museair_mphf_load(&loaded, image, museair_mphf_image_size(&f));  // keys before the first partition.
+    image[8] = first;
+    ok &= museair_mphf_load(&loaded, image, museair_mphf_image_size(&f)) && loaded.n == n;
+    for (size_t i = 0; i < n; i++) {
+        const uint64_t index = museair_mphf_lookup(&f, keys[i], lens[i]);
+        ok &= index < n && !seen[index] && museair_mphf_lookup(&loaded, keys[i], lens[i]) == index;
+        seen[index < n ? index : 0] = true;
+    }
+    free(image);
+    museair_mphf_free(&f), museair_mphf_free(&threaded);
+
+    if (n > 0) {
+        keys[n] = keys[n / 2], lens[n] = lens[n / 2];
+        ok &= !museair_mphf_build(&f, keys, lens, n + 1, n, 1);
+    }
+    return ok;
+}
+
+// Routes 2000 keys of `in` to `n` nodes. Checks that jump hash only moves keys to an added node, that Maglev nodes
+// own as many entries give or take one, before and after a node goes down, that bringing it back up restores every
+// lookup, batched too, and that weighted rendezvous hashing picks the lowest score, batched too, and only moves the
+// keys of a node whose weight drops to 0.
+int RouteMatches(const uint8_t* in, const size_t n) {
+    const void* keys[2000];
+    size_t lens[2000];
+    const void* names[100];
+    size_t name_lens[100];
+    double weights[100];
+    int32_t before[2000], after[2000];
+    bool up[100];
+    for (size_t i = 0; i < 2000; i++)
+        keys[i] = in + i, lens[i] = 8 + i % 20;
+    for (size_t i = 0; i < n; i++)
+        names[i] = in + 7 * i, name_lens[i] = 12, weights[i] = (double)(1 + i % 3), up[i] = i != n / 2;
+
+    int ok = 1;
+    museair_jump_batch(keys, lens, 2000, n, (int32_t)n, before);
+    for (size_t i = 0; i < 2000; i++) {
+        const int32_t grown = museair_jump_hash(keys[i], lens[i], n, (int32_t)n + 1);
+        ok &= before[i] == museair_jump_hash(keys[i], lens[i], n, (int32_t)n) && before[i] < (int32_t)n;
+        ok &= grown == before[i] || grown == (int32_t)n;
+    }
+
+    museair_maglev_t m;
+    ok &= museair_maglev_build(&m, names, name_lens, n, 0, n) == (n > 0);
+    for (int round = 0; n > 0 && round < 3; round++) {
+        if (round == 1 && n == 1) {
+            continue;  // no node left up, checked below.
+        } else if (round == 1) {
+            museair_maglev_rebuild(&m, up);
+        } else if (round == 2) {
+            museair_maglev_rebuild(&m, NULL);
+        }
+        const size_t live = round == 1 ? n - 1 : n;
+        size_t entries[100] = {0};
+        for (uint64_t e = 0; e < m.size; e++) {
+            ok &= m.table[e] < n && (round != 1 || up[m.table[e]]);
+            entries[m.table[e] < n ? m.table[e] : 0]++;
+        }
+        for (size_t i = 0; i < n; i++) {
+            ok &= (round == 1 && !up[i]) || (entries[i] * live >= m.size - live && entries[i] * live <= m.size + live);
+        }
+        museair_maglev_lookup_batch(&m, keys, lens, 2000, after);
+        for (size_t i = 0; i < 2000; i++) {
+            ok &= after[i] == museair_maglev_lookup(&m, keys[i], lens[i]);
+            if (round == 0) {
+                before[i] = after[i];
+            }
+            ok &= round != 2 || after[i] == before[i];
+        }
+    }
+    if (n > 0) {
+        memset(up, 0, sizeof(up));
+        museair_maglev_rebuild(&m, up);
+        ok &= museair_maglev_lookup(&m, keys[0], lens[0]) == -1;
+        museair_maglev_free(&m);
+    }
+
+    museair_rendezvous_t r;
+    ok &= museair_rendezvous_init(&r, names, name_lens, weights, n, n);
+    museair_rendezvous_lookup_batch(&r, keys, lens, 2000, before);
+    for (size_t i = 0; i < 2000; i++) {
+        const uint64_t hash = museair_hash(keys[i], lens[i], n);
+        double best = INFINITY;
+        int32_t node = -1;
+        for (size_t j = 0; j < n; j++) {
+            const double u = _museair_rendezvous_uniform(_museair_rendezvous_mix(hash, r.hashes[j]));
+            if (-log1p(-u) / weights[j] < best) {
+                best = -log1p(-u) / weights[j], node = (int32_t)j;
+            }
+        }
+        ok &= before[i] == node && museair_rendezvous_lookup(&r, keys[i], lens[i]) == node;
+    }
+    if (n > 0) {
+        museair_rendezvous_set_weight(&r, n / 2, 0);
+        for (size_t i = 0; i < 2000; i++) {
+            const int32_t node = museair_rendezvous_lookup(&r, keys[i], lens[i]);
+            ok &= before[i] == (int32_t)(n / 2) ? node != before[i] && (n == 1 || node >= 0) : node == before[i];
+        }
+    }
+    museair_rendezvous_free(&r);
+    return ok;
+}
+
+// Streams 2000 keys of `in`, every tenth one heavy, into sketches of `bits` counters: one by one, batched, and split
+// between two merged sketches. Checks estimates bound the true counts and the tracked heavy keys count exactly, and
+// are the heaviest ones when counters do not saturate.
+int CmsMatches(const uint8_t* in, const int bits, const bool conservative) {
+    const void* keys[2000];
+    size_t lens[2000];
+    uint64_t counts[2000];
+    for (size_t i = 0; i < 2000; i++)
+        keys[i] = in + i, lens[i] = 4 + i % 40, counts[i] = i % 10 ? 1 : 100 + 5 * (i / 10);
+
+    museair_cms_t one, batch, a, b;
+    museair_cms_init(&one, 4096, 4, bits, conservative, 20, bits);
+    museair_cms_init(&batch, 4096, 4, bits, conservative, 20, bits);
+    museair_cms_init(&a, 4096, 4, bits, conservative, 20, bits);
+    museair_cms_init(&b, 4096, 4, bits, conservative, 20, bits);
+    for (size_t i = 0; i < 2000; i++)
+        for (uint64_t c = 0; c < counts[i]; c++)
+            museair_cms_add(&one, keys[i], lens[i], 1);
+    museair_cms_add_batch(&batch, keys, lens, counts, 2000);
+    museair_cms_add_batch(&a, keys, lens, counts, 1000);
+    museair_cms_add_batch(&b, keys + 1000, lens + 1000, counts + 1000, 1000);
+    int ok = museair_cms_merge(&a, &b) && a.total == one.total && batch.total == one.total;
+
+    const uint64_t max = bits == 32 ? UINT32_MAX : (UINT64_C(1) << bits) - 1;
+    for (size_t i = 0; i < 2000; i++) {
+        uint64_t expected = counts[i] < max ? counts[i] : max;
+        ok &= museair_cms_estimate(&one, keys[i], lens[i]) >= expected;
+        ok &= museair_cms_estimate(&batch, keys[i], lens[i]) >= expected;
+        if (!conservative)
+            ok &= museair_cms_estimate(&a, keys[i], lens[i]) == museair_cms_estimate(&batch, keys[i], lens[i]);
+    }
+
+    museair_cms_entry_t top[20];
+    museair_cms_t* sketches[3] = {&one, &batch, &a};
+    for (int t = 0; t < 3; t++) {
+        ok &= museair_cms_top(sketches[t], top) == 20;
+        for (size_t j = 0; j < 20; j++) {
+            size_t i = 0;
+            while (i < 2000 && (counts[i] == 1 || lens[i] != top[j].len || memcmp(top[j].key, keys[i], 4) != 0))
+                i++;
+            ok &= i < 2000 && top[j].count >= counts[i] && top[j].count <= counts[i] + 4;
+            if (bits > 8)
+                ok &= i == 1990 - 10 * j;
+        }
+    }
+    museair_cms_free(&one), museair_cms_free(&batch), museair_cms_free(&a), museair_cms_free(&b);
+    return ok;
+}
+
+// Estimates `n` distinct keys of `in` added one by one, batched, and split between two merged sketches that share a
+// third of the keys, also after a round trip through the serialized form.
+int HllMatches(const uint8_t* in, const size_t n) {
+    const void* keys[3000];
+    size_t lens[3000];
+    for (size_t i = 0; i < n; i++)
+        keys[i] = in + i, lens[i] = 8 + i % 30;
+
+    museair_hll_t one, batch, a, b, copy;
+    museair_hll_init(&one, 10, n);
+    museair_hll_init(&batch, 10, n);
+    museair_hll_init(&a, 10, n);
+    museair_hll_init(&b, 10, n);
+    for (size_t i = 0; i < n; i++) {
+        museair_hll_add(&one, keys[i], lens[i]);
+        if (i < n / 3 * 2)
+            museair_hll_add(&a, keys[i], lens[i]);
+    }
+    museair_hll_add_batch(&batch, keys, lens, n);
+    museair_hll_add_batch(&b, keys + n / 3, lens + n / 3, n - n / 3);
+    museair_hll_merge(&a, &b);
+
+    size_t size = museair_hll_serialized_size(&one);
+    uint8_t* image = (uint8_t*)malloc(size);
+    int ok = museair_hll_serialize(&one, image) == size && !museair_hll_deserialize(&copy, image, size - 1);
+    ok &= museair_hll_deserialize(&copy, image, size) && museair_hll_estimate(&copy) == museair_hll_estimate(&one);
+    ok &= museair_hll_estimate(&batch) == museair_hll_estimate(&one);
+    ok &= fabs(museair_hll_estimate(&one) - (double)n) <= (n < 200 ? 0.01 : 0.1 * (double)n);
+    ok &= fabs(museair_hll_estimate(&a) - museair_hll_estimate(&one)) <= (n < 200 ? 0.01 : 0.05 * (double)n);
+    if (a.dense && one.dense)
+        ok &= memcmp(a.registers, one.registers, 1024) == 0;
+    free(image);
+    museair_hll_free(&one), museair_hll_free(&batch), museair_hll_free(&a), museair_hll_free(&b);
+    museair_hll_free(&copy);
+    return ok;
+}
+
+// Compares the reference, incremental (in `step` bytes pieces) and parallel tree digests of `len` bytes.
+int TreeMatches(const uint8_t* in, const size_t len, const uint64_t seed, const size_t step) {
+    static museair_tree_t t;
+    museair_tree_init(&t, seed);
+    for (size_t off = 0; off < len; off += step)
+        museair_tree_update(&t, in + off, len - off < step ? len - off : step);
+
+    uint64_t hi, hi_expected, hi_plain;
+    uint64_t lo_expected = museair_tree_hash_128(in, len, seed, &hi_expected);
+    uint64_t lo_plain = museair_hash_128(in, len, seed, &hi_plain);
+    int ok = lo_expected != lo_plain || hi_expected != hi_plain;
+    ok &= museair_tree_digest_128(&t, &hi) == lo_expected && hi == hi_expected;
+    ok &= museair_tree_hash_128_parallel(in, len, seed, 4, &hi) == lo_expected && hi == hi_expected;
+    return ok;
+}
+
+#if MUSEAIR_HAS_IOVEC
+// Splits `len` bytes into up to 8 fragments at offsets derived from `cut`, compares to the contiguous digests.
+int IovMatches(const uint8_t* in, const size_t len, const uint64_t seed, size_t cut) {
+    struct iovec iov[8];
+    int cnt = 0;
+    size_t off = 0;
+    while (off < len && cnt < 7) {
+        size_t n = cut % (len - off + 1);
+        iov[cnt].iov_base = (void*)(in + off);
+        iov[cnt++].iov_len = n;
+        off += n;
+        cut = cut * 31 + 17;
+    }
+    iov[cnt].iov_base = (void*)(in + off);
+    iov[cnt++].iov_len = len - off;
+
+    uint64_t hi, hi_expected;
+    int ok = 1;
+    ok &= museair_hash_iov(iov, cnt, seed) == museair_hash(in, len, seed);
+    ok &= museair_bfast_hash_iov(iov, cnt, seed) == museair_bfast_hash(in, len, seed);
+    ok &= museair_hash_128_iov(iov, cnt, seed, &hi) == museair_hash_128(in, len, seed, &hi_expected);
+    ok &= hi == hi_expected;
+    ok &= museair_bfast_hash_128_iov(iov, cnt, seed, &hi) == museair_bfast_hash_128(in, len, seed, &hi_expected);
+    ok &= hi == hi_expected;
+    return ok;
+}
+#endif
+
 int main() {
+#ifdef MUSEAIR_DISPATCH
+    // Built against the dispatched kernels, see "museair_dispatch.c".
+    printf("Long inputs through the %s kernels.\n", museair_dispatch_target());
+#endif
     // ensure we are on a little endian machine
     if (ComputedVerifyImpl(64, hash) != 0x46B2D34D)
         printf("Unexpected museair_hash!\n");
@@ -98,5 +610,205 @@ int main() {
         printf("Unexpected museair_bfast_hash!\n");
     if (ComputedVerifyImpl(128, bfast_hash_128) != 0x81D30B6E)
         printf("Unexpected museair_bfast_hash_128!\n");
+
+    uint8_t* buf = (uint8_t*)malloc(1024);
+    for (int i = 0; i < 1024; i++)
+        buf[i] = (uint8_t)(i * 131 + 7);
+    const size_t steps[] = {1, 7, 16, 95, 96, 97, 200, 1024};
+    for (size_t len = 0; len <= 1024; len++)
+        for (size_t s = 0; s < sizeof(steps) / sizeof(steps[0]); s++)
+            if (!StreamMatches(buf, len, len * 3, steps[s])) {
+                printf("Unexpected museair_stream_t! (len = %zu, step = %zu)\n", len, steps[s]);
+                len = 1024;
+                break;
+            }
+#if MUSEAIR_HAS_IOVEC
+    for (size_t len = 0; len <= 1024; len++)
+        if (!IovMatches(buf, len, len, len * 7 + 3)) {
+            printf("Unexpected museair_hash_iov! (len = %zu)\n", len);
+            break;
+        }
+#endif
+    // Long enough to cross several `MUSEAIR_CSTR_SCAN` windows.
+    char* str = (char*)malloc(4096 + 8);
+    for (size_t len = 0; len <= 4096; len++) {
+        // Different alignments of the string start.
+        char* cstr = str + len % 8;
+        for (size_t i = 0; i < len; i++)
+            cstr[i] = (char)((buf[i % 1024] + i / 1024) | 1);
+        cstr[len] = '\0';
+
+        uint64_t hi, hi_expected;
+        size_t len_a = 0, len_b = 0, len_c = 0, len_d = 0;
+        int ok = museair_hash_cstr(cstr, len, &len_a) == museair_hash(cstr, len, len);
+        ok &= museair_bfast_hash_cstr(cstr, len, &len_b) == museair_bfast_hash(cstr, len, len);
+        ok &= museair_hash_128_cstr(cstr, len, &hi, &len_c) == museair_hash_128(cstr, len, len, &hi_expected);
+        ok &= hi == hi_expected;
+        ok &= museair_bfast_hash_128_cstr(cstr, len, &hi, &len_d) ==
+              museair_bfast_hash_128(cstr, len, len, &hi_expected);
+        ok &= hi == hi_expected && len_a == len && len_b == len && len_c == len && len_d == len;
+        if (!ok) {
+            printf("Unexpected museair_hash_cstr! (len = %zu)\n", len);
+            break;
+        }
+    }
+    // A zero before the string in its first aligned word, then 0x01 bytes that a borrow from it would turn into zeros.
+    for (size_t mis = 1; mis < 64; mis++) {
+        char* cstr = (char*)(((uintptr_t)str + 63) & ~(uintptr_t)63) + mis;
+        memset(cstr - mis, 'a', mis);
+        cstr[-1] = '\0';
+        memset(cstr, 1, mis + 100);
+        cstr[mis + 100] = '\0';
+        size_t len = 0;
+        if (museair_hash_cstr(cstr, 7, &len) != museair_hash(cstr, mis + 100, 7) || len != mis + 100) {
+            printf("Unexpected museair_hash_cstr! (zero before the string, mis = %zu)\n", mis);
+            break;
+        }
+    }
+    free(str);
+
+    uint8_t* copy = (uint8_t*)malloc(1024);
+    for (size_t len = 0; len <= 1024; len++) {
+        uint64_t hi, hi_expected;
+        int ok = museair_copy_and_hash(copy, buf, len, len) == museair_hash(buf, len, len);
+        ok &= museair_bfast_copy_and_hash(copy, buf, len, len) == museair_bfast_hash(buf, len, len);
+        ok &= museair_copy_and_hash_128(copy, buf, len, len, &hi) == museair_hash_128(buf, len, len, &hi_expected);
+        ok &= hi == hi_expected;
+        memset(copy, 0, len);
+        ok &= museair_bfast_copy_and_hash_128(copy, buf, len, len, &hi) ==
+              museair_bfast_hash_128(buf, len, len, &hi_expected);
+        ok &= hi == hi_expected && memcmp(copy, buf, len) == 0;
+        if (!ok) {
+            printf("Unexpected museair_copy_and_hash! (len = %zu)\n", len);
+            break;
+        }
+    }
+    free(copy);
+
+    uint8_t* upper = (uint8_t*)calloc(1024, 1);
+    uint8_t* lower = (uint8_t*)calloc(1024, 1);
+    for (size_t len = 0; len <= 1024; len++) {
+        for (size_t i = 0; i < len; i++) {
+            upper[i] = buf[i] % 3 ? buf[i] : (uint8_t)('A' + buf[i] % 32);  // also hits '[' to '`' and 'a' to 'z'.
+            lower[i] = (uint8_t)tolower(upper[i]);
+        }
+        uint64_t hi, hi_expected;
+        int ok = museair_hash_nocase(upper, len, len) == museair_hash(lower, len, len);
+        ok &= museair_bfast_hash_nocase(upper, len, len) == museair_bfast_hash(lower, len, len);
+        ok &= museair_hash_128_nocase(upper, len, len, &hi) == museair_hash_128(lower, len, len, &hi_expected);
+        ok &= hi == hi_expected;
+        ok &= museair_bfast_hash_128_nocase(upper, len, len, &hi) ==
+              museair_bfast_hash_128(lower, len, len, &hi_expected);
+        ok &= hi == hi_expected;
+        if (!ok) {
+            printf("Unexpected museair_hash_nocase! (len = %zu)\n", len);
+            break;
+        }
+    }
+    free(lower);
+    free(upper);
+
+    for (size_t n = 0; n <= 67; n++)
+        if (!BatchMatches(buf, n, n)) {
+            printf("Unexpected _museair_hash_batch! (n = %zu)\n", n);
+            break;
+        }
+    for (size_t n = 0; n <= 24; n++)
+        if (!ColumnMatches(buf, n, n)) {
+            printf("Unexpected museair_hash_column! (n = %zu)\n", n);
+            break;
+        }
+    for (size_t len = 0; len <= 1024; len++)
+        if (!MultiseedMatches(buf, len, len % 40)) {
+            printf("Unexpected museair_hash_multiseed! (len = %zu)\n", len);
+            break;
+        }
+    // Past `MUSEAIR_MULTISEED_CHUNK` blocks, where the towers share their loads.
+    uint8_t* big = (uint8_t*)malloc(8192);
+    for (size_t i = 0; i < 8192; i++)
+        big[i] = buf[i % 1024] ^ (uint8_t)(i >> 10);
+    for (size_t len = 1500; len <= 8192; len += 97)
+        if (!MultiseedMatches(big, len, len % 40)) {
+            printf("Unexpected museair_hash_multiseed! (len = %zu)\n", len);
+            break;
+        }
+    free(big);
+    free(buf);
+
+    uint64_t x = 0x9E3779B97F4A7C15;
+    for (int n = 0; n < 1000; n++) {
+        x ^= x << 13, x ^= x >> 7, x ^= x << 17;
+        uint32_t v32 = (uint32_t)x;
+        uint64_t v128[2] = {x, ~x * 5};
+        if (museair_hash_u32(v32, x >> 3) != museair_hash(&v32, 4, x >> 3) ||
+            museair_hash_u64(x, n) != museair_hash(&x, 8, n) ||
+            museair_hash_u128(v128[0], v128[1], x) != museair_hash(v128, 16, x)) {
+            printf("Unexpected museair_hash_u32/u64/u128!\n");
+            break;
+        }
+    }
+
+    buf = (uint8_t*)malloc(1024 + 80);
+    for (size_t i = 0; i < 1024 + 80; i++)
+        buf[i] = (uint8_t)(i * 7 + (i >> 8));
+    for (size_t n = 0; n <= 1024; n += 31)
+        if (!BloomMatches(buf, n, n % 2)) {
+            printf("Unexpected museair_bloom! (n = %zu)\n", n);
+            break;
+        }
+    free(buf);
+
+    // Keys of the sketch, filter, MPHF and routing tests: byte strings at every offset of one buffer.
+    buf = (uint8_t*)malloc(5000 + 80);
+    for (size_t i = 0; i < 5000 + 80; i++)
+        buf[i] = (uint8_t)((i * 0x9E3779B97F4A7C15) >> 56);
+    for (int bits = 8; bits <= 32; bits *= 2)
+        if (!CmsMatches(buf, bits, false) || !CmsMatches(buf, bits, true)) {
+            printf("Unexpected museair_cms! (bits = %d)\n", bits);
+            break;
+        }
+
+    const size_t hll_counts[] = {0, 1, 100, 200, 300, 1000, 3000};
+    for (size_t n = 0; n < sizeof(hll_counts) / sizeof(hll_counts[0]); n++)
+        if (!HllMatches(buf, hll_counts[n])) {
+            printf("Unexpected museair_hll! (n = %zu)\n", hll_counts[n]);
+            break;
+        }
+
+    const size_t filter_counts[] = {0, 1, 2, 100, 1001, 3000};
+    for (size_t n = 0; n < sizeof(filter_counts) / sizeof(filter_counts[0]); n++)
+        if (!FilterMatches(buf, filter_counts[n])) {
+            printf("Unexpected museair_fuse/cuckoo! (n = %zu)\n", filter_counts[n]);
+            break;
+        }
+
+    const size_t mphf_counts[] = {0, 1, 2, 100, 999, 2500, 5000};
+    for (size_t n = 0; n < sizeof(mphf_counts) / sizeof(mphf_counts[0]); n++)
+        if (!MphfMatches(buf, mphf_counts[n])) {
+            printf("Unexpected museair_mphf! (n = %zu)\n", mphf_counts[n]);
+            break;
+        }
+
+    const size_t route_counts[] = {0, 1, 2, 3, 10, 100};
+    for (size_t n = 0; n < sizeof(route_counts) / sizeof(route_counts[0]); n++)
+        if (!RouteMatches(buf, route_counts[n])) {
+            printf("Unexpected museair_jump/maglev/rendezvous! (n = %zu)\n", route_counts[n]);
+            break;
+        }
+    free(buf);
+
+    const size_t chunk = MUSEAIR_TREE_CHUNK, fanout = MUSEAIR_TREE_FANOUT;
+    const size_t tree_lens[] = {0, 1, chunk - 1, chunk, chunk + 1, fanout * chunk, fanout * chunk + 1,
+                                (fanout + 1) * chunk + 5};
+    buf = (uint8_t*)malloc((fanout + 2) * chunk);
+    for (size_t i = 0; i < (fanout + 2) * chunk; i++)
+        buf[i] = (uint8_t)(i * 131 + (i >> 16));
+    for (size_t n = 0; n < sizeof(tree_lens) / sizeof(tree_lens[0]); n++)
+        if (!TreeMatches(buf, tree_lens[n], n, n % 2 ? 65536 + 7 : chunk * 3)) {
+            printf("Unexpected museair_tree_hash_128! (len = %zu)\n", tree_lens[n]);
+            break;
+        }
+    free(buf);
+
     printf("Finish.\n");
 }
@@ -0,0 +1,178 @@
+/*
+ * Checks of the C++ interface against the C functions, see "selftests.c" for the algorithm itself.
+ */
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <type_traits>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#include "museair.hpp"
+#include "museair_concurrent_map.hpp"
+#include "museair_flat_map.hpp"
+
+struct Point {
+    int32_t x, y;
+    bool operator==(const Point& o) const { return x == o.x && y == o.y; }
+};
+MUSEAIR_SPECIALIZE_STD_HASH(Point)
+
+using namespace museair::literals;
+
+static constexpr std::string_view LONG_COMMAND =
+    "a command name longer than ninety-six bytes, so that it goes through the twelve-lane layer of the tower";
+
+// Must compile, the case labels are computed at compile time.
+static int Command(std::string_view cmd) {
+    switch (museair::hasher()(cmd)) {
+        case "GET"_museair:
+            return 1;
+        case "PUT"_museair:
+            return 2;
+        case museair::constexpr_hash(LONG_COMMAND):
+            return 3;
+        default:
+            return 0;
+    }
+}
+static_assert(museair::constexpr_hash("GET") != museair::constexpr_bfast_hash("GET", 1), "");
+
+// Random inserts, erases and lookups against `std::unordered_map`, small key space to exercise deleted slots.
+static bool FlatMapMatches() {
+    museair::flat_map<uint64_t, uint64_t> m;
+    std::unordered_map<uint64_t, uint64_t> ref;
+    uint64_t x = 0x9E3779B97F4A7C15;
+    bool ok = true;
+    for (uint64_t n = 0; n < 200000; n++) {
+        x ^= x << 13, x ^= x >> 7, x ^= x << 17;
+        uint64_t key = x % 3000;
+        switch (x >> 62) {
+            case 0:
+                ok &= m.erase(key) == ref.erase(key);
+                break;
+            case 1:
+                ok &= m.insert({key, n}).second == ref.insert({key, n}).second;
+                break;
+            default:
+                auto it = m.find(key);
+                auto r = ref.find(key);
+                ok &= (it == m.end()) == (r == ref.end()) && (it == m.end() || it->second == r->second);
+        }
+    }
+    size_t count = 0;
+    for (const auto& kv : m) {
+        ok &= ref.count(kv.first) && ref[kv.first] == kv.second;
+        count++;
+    }
+    ok &= count == ref.size() && m.size() == ref.size();
+
+    for (auto it = m.begin(); it != m.end();)
+        it = it->first % 2 ? m.erase(it) : std::next(it);
+    museair::flat_map<uint64_t, uint64_t> copy = m, moved = std::move(copy);
+    for (const auto& kv : ref)
+        ok &= moved.contains(kv.first) == (kv.first % 2 == 0);
+
+    museair::flat_map<std::string, int> s;
+    s.reserve(1000);
+    size_t capacity = s.capacity();
+    for (int n = 0; n < 1000; n++)
+        s[std::to_string(n)] = n;
+    ok &= s.capacity() == capacity && s.find(std::string_view("999"))->second == 999 && !s.contains("1000");
+    ok &= s.try_emplace(std::string_view("1000"), 1000).second && s.at("1000") == 1000 && s.erase("5") == 1;
+
+    // Growing moves the string keys into the new slots.
+    museair::flat_map<std::string, int> g;
+    for (int n = 0; n < 1000; n++)
+        g[std::to_string(n)] = n;
+    for (int n = 0; n < 1000; n++)
+        ok &= g.at(std::to_string(n)) == n;
+    static_assert(std::is_const_v<std::remove_reference_t<decltype(g.begin()->first)>>, "");
+    return ok;
+}
+
+// Threads insert overlapping ranges from small initial tables, so shards grow under concurrent readers.
+static bool ConcurrentMapMatches() {
+    museair::concurrent_digest_map m(0, 7, 4);
+    std::vector<std::thread> threads;
+    std::atomic<bool> ok{true};
+    for (uint64_t t = 0; t < 4; t++)
+        threads.emplace_back([&, t] {
+            for (uint64_t key = t * 10000; key < t * 10000 + 20000; key++) {
+                auto r = m.insert(&key, sizeof(key), key * 3);
+                uint64_t value;
+                if (r.first != key * 3 || !m.find(&key, sizeof(key), &value) || value != key * 3)
+                    ok = false;
+            }
+        });
+    for (auto& thread : threads)
+        thread.join();
+
+    uint64_t value, absent = 50000;
+    for (uint64_t key = 0; key < 50000; key++)
+        if (!m.find(&key, sizeof(key), &value) || value != key * 3 || m.insert(&key, sizeof(key), 0).second)
+            ok = false;
+    return ok && m.size() == 50000 && !m.find(&absent, sizeof(absent), &value);
+}
+
+int main() {
+    const char* msg = "It's a beautiful day outside";
+    const size_t len = strlen(msg);
+
+    museair::hasher h;
+    museair::bfast_hasher bh(42);
+    if (h(msg) != museair_hash(msg, len, 0) || h(std::string(msg)) != museair_hash(msg, len, 0) ||
+        h(std::string_view(msg, 5)) != museair_hash(msg, 5, 0) || bh(msg) != museair_bfast_hash(msg, len, 42))
+        printf("Unexpected museair::hasher on strings!\n");
+#if MUSEAIR_HAS_SPAN
+    if (h(std::as_bytes(std::span(msg, len))) != museair_hash(msg, len, 0))
+        printf("Unexpected museair::hasher on spans!\n");
+#endif
+
+    uint64_t u64 = 0x0123456789abcdef;
+    uint16_t u16 = 0xbeef;
+    uint64_t* ptr = &u64;
+    if (h(u64) != museair_hash(&u64, 8, 0) || h(u16) != museair_hash(&u16, 2, 0) ||
+        h(ptr) != museair_hash(&ptr, sizeof(ptr), 0))
+        printf("Unexpected museair::hasher on scalars!\n");
+
+    Point p = {3, -4};
+    if (std::hash<Point>()(p) != museair_hash(&p, sizeof(p), 0))
+        printf("Unexpected MUSEAIR_SPECIALIZE_STD_HASH!\n");
+
+    std::unordered_map<std::string, int, museair::hasher, museair::equal_to> m;
+    m["alpha"] = 1;
+    m["beta"] = 2;
+    std::unordered_set<Point> points = {{1, 2}, {3, 4}};
+#if __cplusplus >= 202002L
+    if (m.find(std::string_view("beta"))->second != 2 || m.count("gamma") != 0 || !points.count({3, 4}))
+#else
+    if (m.find("beta")->second != 2 || m.count("gamma") != 0 || !points.count({3, 4}))
+#endif
+        printf("Unexpected museair::hasher in containers!\n");
+
+    char buf[512];
+    for (size_t i = 0; i < sizeof(buf); i++)
+        buf[i] = (char)(i * 131 + 7);
+    for (size_t n = 0; n <= sizeof(buf); n++) {
+        std::string_view s(buf, n);
+        if (museair::constexpr_hash(s, n) != museair_hash(buf, n, n) ||
+            museair::constexpr_bfast_hash(s, n) != museair_bfast_hash(buf, n, n)) {
+            printf("Unexpected museair::constexpr_hash! (len = %zu)\n", n);
+            break;
+        }
+    }
+    if (Command("GET") != 1 || Command("PUT") != 2 || Command("DELETE") != 0 ||
+        Command(LONG_COMMAND) != 3)
+        printf("Unexpected _museair literal!\n");
+
+    if (!FlatMapMatches())
+        printf("Unexpected museair::flat_map!\n");
+    if (!ConcurrentMapMatches())
+        printf("Unexpected museair::concurrent_digest_map!\n");
+
+    printf("Finish.\n");
+}